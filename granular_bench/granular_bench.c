@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SMOL_UTILS_IMPLEMENTATION
+#include "smol_utils.h"
+
+#define SMOL_AUDIO_IMPLEMENTATION
+#include "smol_audio.h"
+
+#include "granular_synth.h"
+
+// benchmark suite for the grain kernel, voices, the whole synth and the reverb
+//
+// usage: granular_bench <sample.wav|.qoa> [-seconds s] [-workers n] [-sample resident|s16|f16|mapped|stream|qoa] [-json] [-o file]
+//
+// every case renders the given amount of audio (2 s by default) and reports
+// ns_per_sample: wall time per rendered output frame
+// ns_per_grain: ns_per_sample divided by the average number of playing grains (grain and voice cases)
+// voices_per_core: how many such voices one core renders in real time (for synth cases polyphony times
+//   the real-time factor, so the mix and reverb overhead is spread over the voices)
+// voice and synth cases randomize grain starts by up to half the grain size (position_offset_random 0.5),
+//   grain sizes are not randomized
+// -sample picks how the sample is loaded (resident by default, like the synth), s16 and f16 keep it
+//   resident at half the size of resident float32 planes, mapped decodes integer pcm by page, qoa keeps a .qoa sample compressed, streaming runs
+//   faster than real time here, so the prefetch thread falls behind and part of it renders silence
+// results are written as csv, or as json with -json, to stdout or the -o file
+
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_BANK_GRAINS 4096
+
+typedef struct bench_result_t {
+	const char* group;
+	const char* play_mode;
+	double grain_size; // seconds, 0 when it does not apply
+	int density; // grains per second, or playing grains for the kernel
+	int polyphony;
+	int workers;
+	double ns_per_sample;
+	double ns_per_grain;
+	double voices_per_core;
+} bench_result_t;
+
+typedef smol_vector(bench_result_t) bench_results_t;
+
+static const char* play_mode_names[] = { "forward", "reverse", "pingpong" };
+
+static double bench_seconds = 2.0;
+
+static void add_result(bench_results_t* results, bench_result_t result) {
+	result.voices_per_core = result.ns_per_sample > 0.0 ? result.polyphony * 1e9 / (result.ns_per_sample * BENCH_SAMPLE_RATE) : 0.0;
+	smol_vector_push(results, result);
+	fprintf(stderr, "%-8s %-8s size %.3f density %4d poly %d: %8.1f ns/sample\n",
+		result.group, result.play_mode, result.grain_size, result.density, result.polyphony, result.ns_per_sample);
+}
+
+// grain_pool_render_frame with a fixed number of playing grains, finished grains are replaced between blocks
+static void bench_grain_kernel(bench_results_t* results, sample_source_t* source) {
+	static const double sizes[] = { 0.05, 0.5 };
+	static const int counts[] = { 1, 4, 16, GS_GRAIN_CHUNK_SIZE };
+
+	const window_table_t* window = window_table_default();
+	const int num_frames = (int)(bench_seconds * BENCH_SAMPLE_RATE);
+
+	for (int mode = GRAIN_FORWARD; mode <= GRAIN_PINGPONG; mode++)
+	for (int s = 0; s < 2; s++)
+	for (int c = 0; c < 4; c++) {
+		grain_pool_t pool;
+		grain_pool_init(&pool);
+		smol_randomize(1);
+
+		double elapsed = 0.0;
+		double grain_frames = 0.0;
+		for (int frame = 0; frame < num_frames; frame += GS_BLOCK_SIZE) {
+			while (grain_pool_active_count(&pool) < counts[c]) {
+				const double position = smol_randf() * (source->duration - sizes[s]);
+				grain_pool_spawn(&pool, (grain_play_mode)mode, position, sizes[s], 1.0f, 0.5f, window, 0.5f, BENCH_SAMPLE_RATE, BENCH_SAMPLE_RATE);
+			}
+
+			float out[GS_MAX_CHANNELS] = { 0.0f };
+			const double start = smol_timer();
+			sample_source_collect(source);
+			for (int i = 0; i < GS_BLOCK_SIZE; i++) {
+				grain_pool_render_frame(&pool, source, out, 2);
+			}
+			elapsed += smol_timer() - start;
+			grain_frames += (double)counts[c] * GS_BLOCK_SIZE;
+
+			// keeps the result alive
+			if (out[0] == 12345.0f) fprintf(stderr, " ");
+		}
+
+		bench_result_t result = { 0 };
+		result.group = "grain";
+		result.play_mode = play_mode_names[mode];
+		result.grain_size = sizes[s];
+		result.density = counts[c];
+		result.polyphony = 1;
+		result.ns_per_sample = elapsed * 1e9 / num_frames;
+		result.ns_per_grain = elapsed * 1e9 / grain_frames;
+		add_result(results, result);
+	}
+}
+
+// voice_render_block, including grain spawning, the filter and the envelopes
+static void bench_voice(bench_results_t* results, sample_source_t* source) {
+	static const double sizes[] = { 0.05, 0.25, 1.0 };
+	static const int densities[] = { 8, 32, 128 };
+
+	grain_bank_t bank;
+	if (!grain_bank_init(&bank, BENCH_BANK_GRAINS)) {
+		fprintf(stderr, "Out of memory\n");
+		return;
+	}
+
+	const int num_frames = (int)(bench_seconds * BENCH_SAMPLE_RATE);
+
+	for (int mode = GS_PLAY_FORWARD; mode <= GS_PLAY_PINGPONG; mode++)
+	for (int s = 0; s < 3; s++)
+	for (int d = 0; d < 3; d++) {
+		voice_t voice;
+		voice_init(&voice, BENCH_SAMPLE_RATE);
+		voice.grain_bank = &bank;
+		voice.grain_settings.size = sizes[s];
+		voice.grain_settings.position = 0.0;
+		voice.grain_settings.grains_per_second = densities[d];
+		voice.grain_settings.play_mode = (granular_synth_play_mode)mode;
+		voice.random_settings.position_offset_random = 0.5f;
+		voice_gate(&voice, 1);
+
+		float left[GS_BLOCK_SIZE], right[GS_BLOCK_SIZE];
+		float* out[2] = { left, right };
+
+		double elapsed = 0.0;
+		double grain_frames = 0.0;
+		for (int frame = 0; frame < num_frames; frame += GS_BLOCK_SIZE) {
+			memset(left, 0, sizeof(left));
+			memset(right, 0, sizeof(right));
+
+			const double start = smol_timer();
+			sample_source_collect(source);
+			voice_render_block(&voice, source, out, 2, GS_BLOCK_SIZE, BENCH_SAMPLE_RATE);
+			elapsed += smol_timer() - start;
+
+			for (int i = 0; i < voice.num_grain_chunks; i++) {
+				grain_frames += (double)grain_pool_active_count(voice.grains[i]) * GS_BLOCK_SIZE;
+			}
+		}
+		voice_release_grains(&voice);
+
+		bench_result_t result = { 0 };
+		result.group = "voice";
+		result.play_mode = play_mode_names[mode];
+		result.grain_size = sizes[s];
+		result.density = densities[d];
+		result.polyphony = 1;
+		result.ns_per_sample = elapsed * 1e9 / num_frames;
+		result.ns_per_grain = grain_frames > 0.0 ? elapsed * 1e9 / grain_frames : 0.0;
+		add_result(results, result);
+	}
+
+	grain_bank_free(&bank);
+}
+
+static granular_synth_t synth;
+
+// granular_synth_render_block with all voices, the mix and the reverb
+static void bench_synth(bench_results_t* results, const char* sample_path, sample_load_mode sample_mode, int workers) {
+	static const int polyphonies[] = { 1, 2, 4, GS_SYNTH_MAX_VOICES };
+
+	const int num_frames = (int)(bench_seconds * BENCH_SAMPLE_RATE);
+
+	if (!granular_synth_init(&synth, BENCH_SAMPLE_RATE, sample_path)) {
+		fprintf(stderr, "Failed to initialize the synth\n");
+		granular_synth_free(&synth);
+		return;
+	}
+	if (sample_mode != SAMPLE_LOAD_RESIDENT) {
+		granular_synth_load_sample(&synth, sample_path, sample_mode);
+	}
+	granular_synth_set_max_grains(&synth, BENCH_BANK_GRAINS);
+	synth.sample.window_start = 0.0;
+	synth.sample.window_end = 0.25;
+	synth.grain_settings.grains_per_second = 32;
+	synth.grain_settings.play_mode = GS_PLAY_PINGPONG;
+	synth.random_settings.position_offset_random = 0.5f;
+
+	const int num_runs = workers > 0 ? 2 : 1;
+	for (int run = 0; run < num_runs; run++) {
+		const int run_workers = run == 0 ? 0 : granular_synth_start_workers(&synth, workers);
+
+		for (int p = 0; p < 4; p++) {
+			granular_synth_set_seed(&synth, GS_DEFAULT_SEED);
+			for (int i = 0; i < polyphonies[p]; i++) {
+				granular_synth_noteon(&synth, 60 + i, 1.0f + 0.1f * i, 0.5f);
+			}
+
+			float left[GS_BLOCK_SIZE], right[GS_BLOCK_SIZE];
+			float* out[2] = { left, right };
+
+			const double start = smol_timer();
+			for (int frame = 0; frame < num_frames; frame += GS_BLOCK_SIZE) {
+				granular_synth_render_block(&synth, out, 2, GS_BLOCK_SIZE);
+			}
+			const double elapsed = smol_timer() - start;
+
+			// let the voices ring out so the next case starts from silence
+			for (int i = 0; i < polyphonies[p]; i++) {
+				granular_synth_noteoff(&synth, 60 + i);
+			}
+			while (granular_synth_active_voice_count(&synth) > 0) {
+				granular_synth_render_block(&synth, out, 2, GS_BLOCK_SIZE);
+			}
+
+			bench_result_t result = { 0 };
+			result.group = "synth";
+			result.play_mode = play_mode_names[GS_PLAY_PINGPONG];
+			result.grain_size = synth.sample.window_end - synth.sample.window_start;
+			result.density = synth.grain_settings.grains_per_second;
+			result.polyphony = polyphonies[p];
+			result.workers = run_workers;
+			result.ns_per_sample = elapsed * 1e9 / num_frames;
+			add_result(results, result);
+		}
+
+		granular_synth_stop_workers(&synth);
+	}
+
+	granular_synth_free(&synth);
+}
+
+// sf_reverb_process in GS_BLOCK_SIZE blocks of noise, for each preset at each quality tier
+static void bench_reverb(bench_results_t* results) {
+	static const sf_reverb_preset presets[] = {
+		SF_REVERB_PRESET_DEFAULT, SF_REVERB_PRESET_SMALLROOM1,
+		SF_REVERB_PRESET_LARGEHALL1, SF_REVERB_PRESET_LONGREVERB1
+	};
+	static const char* preset_names[] = { "default", "smallroom1", "largehall1", "longreverb1" };
+	static sf_reverb_state_st reverb;
+
+	const int num_frames = (int)(bench_seconds * BENCH_SAMPLE_RATE);
+
+	sf_sample_st input[GS_BLOCK_SIZE], output[GS_BLOCK_SIZE];
+	smol_randomize(1);
+	for (int i = 0; i < GS_BLOCK_SIZE; i++) {
+		input[i].L = smol_rndf(-0.5f, 0.5f);
+		input[i].R = smol_rndf(-0.5f, 0.5f);
+	}
+
+	static const char* quality_names[] = { "high", "normal", "draft" };
+	static char variant_names[4][3][32];
+
+	for (int p = 0; p < 4; p++) {
+		sf_presetreverb(&reverb, BENCH_SAMPLE_RATE, presets[p]);
+
+		for (int q = 0; q < 3; q++) {
+			sf_reverb_set_quality(&reverb, (sf_reverb_quality)q);
+
+			const double start = smol_timer();
+			for (int frame = 0; frame < num_frames; frame += GS_BLOCK_SIZE) {
+				sf_reverb_process(&reverb, GS_BLOCK_SIZE, input, output);
+			}
+			const double elapsed = smol_timer() - start;
+
+			snprintf(variant_names[p][q], sizeof(variant_names[p][q]), "%s/%s", preset_names[p], quality_names[q]);
+
+			bench_result_t result = { 0 };
+			result.group = "reverb";
+			result.play_mode = variant_names[p][q];
+			result.polyphony = 1;
+			result.ns_per_sample = elapsed * 1e9 / num_frames;
+			add_result(results, result);
+		}
+	}
+
+	sf_reverb_free(&reverb);
+}
+
+static void write_results(FILE* fp, bench_results_t* results, int json) {
+	const size_t count = smol_vector_count(results);
+
+	if (json) {
+		fprintf(fp, "{\n  \"sample_rate\": %d,\n  \"seconds\": %g,\n  \"results\": [\n", BENCH_SAMPLE_RATE, bench_seconds);
+	} else {
+		fprintf(fp, "group,variant,grain_size,density,polyphony,workers,ns_per_sample,ns_per_grain,voices_per_core\n");
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		bench_result_t* r = &smol_vector_at(results, i);
+		if (json) {
+			fprintf(fp,
+				"    { \"group\": \"%s\", \"variant\": \"%s\", \"grain_size\": %g, \"density\": %d, \"polyphony\": %d, "
+				"\"workers\": %d, \"ns_per_sample\": %.2f, \"ns_per_grain\": %.3f, \"voices_per_core\": %.2f }%s\n",
+				r->group, r->play_mode, r->grain_size, r->density, r->polyphony,
+				r->workers, r->ns_per_sample, r->ns_per_grain, r->voices_per_core, i + 1 < count ? "," : ""
+			);
+		} else {
+			fprintf(fp, "%s,%s,%g,%d,%d,%d,%.2f,%.3f,%.2f\n",
+				r->group, r->play_mode, r->grain_size, r->density, r->polyphony,
+				r->workers, r->ns_per_sample, r->ns_per_grain, r->voices_per_core
+			);
+		}
+	}
+
+	if (json) {
+		fprintf(fp, "  ]\n}\n");
+	}
+}
+
+static int parse_sample_mode(const char* name, sample_load_mode* mode) {
+	if (strcmp(name, "resident") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT;
+	} else if (strcmp(name, "s16") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT_S16;
+	} else if (strcmp(name, "f16") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT_F16;
+	} else if (strcmp(name, "mapped") == 0) {
+		*mode = SAMPLE_LOAD_MAPPED;
+	} else if (strcmp(name, "stream") == 0) {
+		*mode = SAMPLE_LOAD_STREAM;
+	} else if (strcmp(name, "qoa") == 0) {
+		*mode = SAMPLE_LOAD_QOA;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <sample.wav|.qoa> [-seconds s] [-workers n] [-sample resident|s16|f16|mapped|stream|qoa] [-json] [-o file]\n", argv[0]);
+		return 1;
+	}
+
+	const char* sample_path = argv[1];
+	const char* output_path = NULL;
+	int json = 0;
+	int workers = 0;
+	sample_load_mode sample_mode = SAMPLE_LOAD_RESIDENT;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-json") == 0) {
+			json = 1;
+		} else if (strcmp(argv[i], "-seconds") == 0 && i + 1 < argc) {
+			bench_seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-workers") == 0 && i + 1 < argc) {
+			workers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (strcmp(argv[i], "-sample") == 0 && i + 1 < argc) {
+			if (!parse_sample_mode(argv[++i], &sample_mode)) {
+				fprintf(stderr, "Unknown sample mode %s\n", argv[i]);
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	static sample_source_t source;
+	if (!sample_source_open(&source, sample_path, sample_mode)) {
+		fprintf(stderr, "Failed to load sample %s\n", sample_path);
+		return 1;
+	}
+
+	bench_results_t results = { 0 };
+	smol_vector_init(&results, 128);
+
+	bench_grain_kernel(&results, &source);
+	bench_voice(&results, &source);
+	bench_synth(&results, sample_path, sample_mode, workers);
+	bench_reverb(&results);
+
+	FILE* fp = output_path ? fopen(output_path, "w") : stdout;
+	if (!fp) {
+		fprintf(stderr, "Failed to open %s\n", output_path);
+		return 1;
+	}
+	write_results(fp, &results, json);
+	if (fp != stdout) fclose(fp);
+
+	smol_vector_free(&results);
+	sample_source_free(&source);
+	return 0;
+}
@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SMOL_UTILS_IMPLEMENTATION
+#include "smol_utils.h"
+
+#define SMOL_AUDIO_IMPLEMENTATION
+#include "smol_audio.h"
+
+#include "granular_synth.h"
+
+// headless renderer: plays a note/parameter script through the synth and writes the result to a wav file
+//
+// usage: granular_render <script> <sample.wav|.qoa> <output.wav> [-bits 16|24|32] [-workers n] [-tail seconds] [-seed n] [-sample resident|s16|f16|mapped|stream|qoa]
+// -sample defaults to resident (decoded up front) like the synth, mapped and stream are opt-in
+//
+// every script line is "<time in seconds> <command> [arguments]", # starts a comment
+//   0.0 noteon <id> <midi note> <velocity 0..1>
+//   2.0 noteoff <id>
+//   0.0 set <parameter> <value>
+//   4.0 load <sample> [mode]       (swaps the sample in like a live load: notes playing finish on the old one,
+//                                 later notes play the new one, the window is kept. mode defaults to -sample)
+//   8.0 end                       (stop rendering here instead of after the tail)
+// parameters: window_start, window_end, grains_per_second, smoothness, play_mode (forward, reverse, pingpong, random),
+//   window (sigmoid, hann, gaussian, trapezoid), size_random, position_random, tuning, steal (none, oldest, quietest, same_note),
+//   reverb (high, normal, draft)
+// size_random adds 0..value seconds to every grain, position_random moves its start by up to value times the grain size
+// either way. both are drawn per voice from -seed, see random_script.txt
+
+#define RENDER_MAX_LINE 256
+
+typedef enum render_event_type {
+	EVENT_NOTE_ON = 0,
+	EVENT_NOTE_OFF,
+	EVENT_SET,
+	EVENT_LOAD,
+	EVENT_END
+} render_event_type;
+
+typedef struct render_event_t {
+	double time;
+	int order; // script line, keeps events at the same time in order
+	render_event_type type;
+	uint32_t id;
+	float note, velocity;
+	char parameter[32];
+	char value[32];
+	char path[RENDER_MAX_LINE];
+} render_event_t;
+
+typedef smol_vector(render_event_t) render_events_t;
+
+float pitch_from_midi(float note) {
+	// note should start at C (same mapping as the GUI)
+	note -= 3.0f;
+	return powf(2.0f, (note - 69.0f) / 12.0f);
+}
+
+static int compare_events(const void* a, const void* b, void* user_data) {
+	(void)user_data;
+	const render_event_t* eventA = (const render_event_t*)a;
+	const render_event_t* eventB = (const render_event_t*)b;
+	if (eventA->time != eventB->time) {
+		return eventA->time < eventB->time ? -1 : 1;
+	}
+	return eventA->order < eventB->order ? -1 : 1;
+}
+
+int load_script(const char* path, render_events_t* events) {
+	FILE* fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "Failed to open script %s\n", path);
+		return 0;
+	}
+
+	char line[RENDER_MAX_LINE];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		line_number++;
+
+		char* comment = strchr(line, '#');
+		if (comment) *comment = '\0';
+
+		render_event_t event = { 0 };
+		event.order = line_number;
+		char command[32] = { 0 };
+		int count = sscanf(line, "%lf %31s", &event.time, command);
+		if (count <= 0) continue; // blank line
+
+		int ok = count == 2;
+		if (ok && strcmp(command, "noteon") == 0) {
+			event.type = EVENT_NOTE_ON;
+			ok = sscanf(line, "%*f %*s %u %f %f", &event.id, &event.note, &event.velocity) == 3;
+		} else if (ok && strcmp(command, "noteoff") == 0) {
+			event.type = EVENT_NOTE_OFF;
+			ok = sscanf(line, "%*f %*s %u", &event.id) == 1;
+		} else if (ok && strcmp(command, "set") == 0) {
+			event.type = EVENT_SET;
+			ok = sscanf(line, "%*f %*s %31s %31s", event.parameter, event.value) == 2;
+		} else if (ok && strcmp(command, "load") == 0) {
+			event.type = EVENT_LOAD;
+			ok = sscanf(line, "%*f %*s %255s %31s", event.path, event.value) >= 1;
+		} else if (ok && strcmp(command, "end") == 0) {
+			event.type = EVENT_END;
+		} else {
+			ok = 0;
+		}
+
+		if (!ok || event.time < 0.0) {
+			fprintf(stderr, "%s:%d: invalid line\n", path, line_number);
+			fclose(fp);
+			return 0;
+		}
+
+		smol_vector_push(events, event);
+	}
+	fclose(fp);
+
+	if (smol_vector_count(events) > 1) {
+		smol_sort_vector(events, compare_events);
+	}
+	return 1;
+}
+
+static int parse_option(const char* value, const char** names, int count) {
+	for (int i = 0; i < count; i++) {
+		if (strcmp(value, names[i]) == 0) return i;
+	}
+	return -1;
+}
+
+int apply_parameter(granular_synth_t* synth, const char* parameter, const char* value) {
+	static const char* play_modes[] = { "forward", "reverse", "pingpong", "random" };
+	static const char* windows[] = { "sigmoid", "hann", "gaussian", "trapezoid" };
+	static const char* steal_policies[] = { "none", "oldest", "quietest", "same_note" };
+	static const char* reverb_qualities[] = { "high", "normal", "draft" };
+
+	const double number = atof(value);
+
+	if (strcmp(parameter, "window_start") == 0) {
+		synth->sample.window_start = number;
+	} else if (strcmp(parameter, "window_end") == 0) {
+		synth->sample.window_end = number;
+	} else if (strcmp(parameter, "grains_per_second") == 0) {
+		synth->grain_settings.grains_per_second = number < 1.0 ? 1 : (int)number;
+	} else if (strcmp(parameter, "smoothness") == 0) {
+		synth->grain_settings.grain_smoothness = (float)number;
+	} else if (strcmp(parameter, "size_random") == 0) {
+		synth->random_settings.size_random = number;
+	} else if (strcmp(parameter, "position_random") == 0) {
+		synth->random_settings.position_offset_random = (float)number;
+	} else if (strcmp(parameter, "tuning") == 0) {
+		synth->tuning = (float)number;
+	} else if (strcmp(parameter, "play_mode") == 0) {
+		int mode = parse_option(value, play_modes, 4);
+		if (mode < 0) return 0;
+		synth->grain_settings.play_mode = (granular_synth_play_mode)mode;
+	} else if (strcmp(parameter, "window") == 0) {
+		int shape = parse_option(value, windows, 4);
+		if (shape < 0) return 0;
+		synth->grain_settings.window_shape = (grain_window_shape)shape;
+	} else if (strcmp(parameter, "steal") == 0) {
+		int policy = parse_option(value, steal_policies, 4);
+		if (policy < 0) return 0;
+		synth->voice_allocator.steal_policy = (voice_steal_policy)policy;
+	} else if (strcmp(parameter, "reverb") == 0) {
+		int quality = parse_option(value, reverb_qualities, 3);
+		if (quality < 0) return 0;
+		granular_synth_set_reverb_quality(synth, (sf_reverb_quality)quality);
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+static int parse_sample_mode(const char* name, sample_load_mode* mode) {
+	if (strcmp(name, "resident") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT;
+	} else if (strcmp(name, "s16") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT_S16;
+	} else if (strcmp(name, "f16") == 0) {
+		*mode = SAMPLE_LOAD_RESIDENT_F16;
+	} else if (strcmp(name, "mapped") == 0) {
+		*mode = SAMPLE_LOAD_MAPPED;
+	} else if (strcmp(name, "stream") == 0) {
+		*mode = SAMPLE_LOAD_STREAM;
+	} else if (strcmp(name, "qoa") == 0) {
+		*mode = SAMPLE_LOAD_QOA;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+static granular_synth_t synth;
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		fprintf(stderr, "usage: %s <script> <sample.wav|.qoa> <output.wav> [-bits 16|24|32] [-workers n] [-tail seconds] [-seed n] [-sample resident|s16|f16|mapped|stream|qoa]\n", argv[0]);
+		return 1;
+	}
+
+	const char* script_path = argv[1];
+	const char* sample_path = argv[2];
+	const char* output_path = argv[3];
+
+	int bits = 16;
+	int workers = 0;
+	double tail = 3.0; // release and reverb tail after the last event
+	unsigned long long seed = GS_DEFAULT_SEED; // same seed, same script: same output, whatever -workers says
+	sample_load_mode sample_mode = SAMPLE_LOAD_RESIDENT; // like the synth, mapped and stream render the same
+
+	for (int i = 4; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-bits") == 0) {
+			bits = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-workers") == 0) {
+			workers = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-tail") == 0) {
+			tail = atof(argv[i + 1]);
+		} else if (strcmp(argv[i], "-seed") == 0) {
+			seed = strtoull(argv[i + 1], NULL, 10);
+		} else if (strcmp(argv[i], "-sample") == 0) {
+			if (!parse_sample_mode(argv[i + 1], &sample_mode)) {
+				fprintf(stderr, "Unknown sample mode %s\n", argv[i + 1]);
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (bits != 16 && bits != 24 && bits != 32) {
+		fprintf(stderr, "Unsupported bit depth %d\n", bits);
+		return 1;
+	}
+
+	render_events_t events = { 0 };
+	smol_vector_init(&events, 64);
+	if (!load_script(script_path, &events)) {
+		return 1;
+	}
+
+	if (!smol_file_exists(sample_path)) {
+		fprintf(stderr, "Sample %s not found\n", sample_path);
+		return 1;
+	}
+
+	// the synth renders at the sample's own rate, mapping the file only reads its header
+	sample_source_t probe;
+	sample_source_open(&probe, sample_path, SAMPLE_LOAD_MAPPED);
+	const int sample_rate = probe.sample_rate;
+	sample_source_free(&probe);
+	if (sample_rate <= 0) {
+		fprintf(stderr, "Failed to load sample %s\n", sample_path);
+		return 1;
+	}
+
+	if (!granular_synth_init(&synth, sample_rate, sample_path)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	if (sample_mode != SAMPLE_LOAD_RESIDENT) {
+		granular_synth_load_sample(&synth, sample_path, sample_mode);
+	}
+	granular_synth_set_seed(&synth, seed);
+	if (workers > 0) {
+		workers = granular_synth_start_workers(&synth, workers);
+	}
+
+	// render length: up to an end event, otherwise the last event plus the tail
+	const size_t num_events = smol_vector_count(&events);
+	double length = 0.0;
+	int has_end = 0;
+	for (size_t i = 0; i < num_events; i++) {
+		render_event_t* event = &smol_vector_at(&events, i);
+		if (event->type == EVENT_END) {
+			length = event->time;
+			has_end = 1;
+			break;
+		}
+		length = event->time;
+	}
+	if (!has_end) {
+		length += tail;
+	}
+
+	const int num_frames = (int)ceil(length * sample_rate);
+	float* samples = malloc(sizeof(float) * 2 * (num_frames > 0 ? num_frames : 1));
+	if (!samples) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	float left[GS_BLOCK_SIZE], right[GS_BLOCK_SIZE];
+	float* outputs[2] = { left, right };
+
+	const double start_time = smol_timer();
+
+	int frame = 0;
+	size_t next_event = 0;
+	while (frame < num_frames) {
+		// events are applied at the first frame at or after their time
+		while (next_event < num_events) {
+			render_event_t* event = &smol_vector_at(&events, next_event);
+			if ((int)ceil(event->time * sample_rate) > frame) break;
+
+			switch (event->type) {
+				case EVENT_NOTE_ON:
+					if (!granular_synth_noteon(&synth, event->id, pitch_from_midi(event->note), event->velocity)) {
+						fprintf(stderr, "No voice left for note %g at %.3f s, dropped it\n", event->note, event->time);
+					}
+					break;
+				case EVENT_NOTE_OFF:
+					granular_synth_noteoff(&synth, event->id);
+					break;
+				case EVENT_SET:
+					if (!apply_parameter(&synth, event->parameter, event->value)) {
+						fprintf(stderr, "Unknown parameter or value: %s %s\n", event->parameter, event->value);
+					}
+					break;
+				case EVENT_LOAD: {
+					sample_load_mode mode = sample_mode;
+					if (event->value[0] && !parse_sample_mode(event->value, &mode)) {
+						fprintf(stderr, "Unknown sample mode %s\n", event->value);
+						break;
+					}
+					// waits for the loader, so the swap lands on the same frame every run
+					const int32_t id = granular_synth_load_sample_async(&synth, event->path, mode);
+					if (sample_manager_wait(&synth.sample.manager, id) != 1) {
+						fprintf(stderr, "Failed to load sample %s\n", event->path);
+					}
+					break;
+				}
+				default: break;
+			}
+			next_event++;
+		}
+
+		int frames = num_frames - frame < GS_BLOCK_SIZE ? num_frames - frame : GS_BLOCK_SIZE;
+		if (next_event < num_events) {
+			const int event_frame = (int)ceil(smol_vector_at(&events, next_event).time * sample_rate);
+			if (event_frame - frame < frames) frames = event_frame - frame;
+		}
+
+		// streamed and qoa samples: the prefetch thread is given the time it would have in real time
+		granular_synth_prefetch_sample(&synth);
+		granular_synth_render_block(&synth, outputs, 2, frames);
+
+		for (int i = 0; i < frames; i++) {
+			samples[(frame + i) * 2 + 0] = left[i];
+			samples[(frame + i) * 2 + 1] = right[i];
+		}
+		frame += frames;
+	}
+
+	const double elapsed = smol_timer() - start_time;
+	const int cache_misses = gs_atomic_load(&synth.sample.source->cache.misses);
+
+	granular_synth_free(&synth);
+
+	smol_audiobuffer_t output = { 0 };
+	output.samples = samples;
+	output.sample_rate = sample_rate;
+	output.num_channels = 2;
+	output.num_frames = num_frames;
+	output.stride = 1;
+	output.duration = (double)num_frames / sample_rate;
+
+	if (!smol_audiobuffer_save_wav(&output, output_path, (smol_u16)bits)) {
+		fprintf(stderr, "Failed to write %s\n", output_path);
+		free(samples);
+		return 1;
+	}
+
+	printf("Rendered %.2f s of audio in %.3f s (%d workers)\n", output.duration, elapsed, workers);
+	printf("Real-time factor: %.1fx\n", elapsed > 0.0 ? output.duration / elapsed : 0.0);
+	if (sample_mode == SAMPLE_LOAD_STREAM || cache_misses > 0) {
+		printf("Cache misses: %d frames\n", cache_misses);
+	}
+
+	free(samples);
+	smol_vector_free(&events);
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+
+#include "deadline_profiler.h"
+
+#define LOAD_UNITS 10000 // 1.0 load
+
+static void _deadline_profiler_clear(deadline_profiler_t* profiler) {
+	for (int i = 0; i < GS_PROFILER_BINS; i++) {
+		gs_atomic_store(&profiler->histogram[i], 0);
+	}
+	gs_atomic_store(&profiler->callbacks, 0);
+	gs_atomic_store(&profiler->overruns, 0);
+	gs_atomic_store(&profiler->late, 0);
+	gs_atomic_store(&profiler->min_load, INT32_MAX);
+	gs_atomic_store(&profiler->max_load, 0);
+	gs_atomic_store(&profiler->last_load, 0);
+}
+
+void deadline_profiler_init(deadline_profiler_t* profiler) {
+	_deadline_profiler_clear(profiler);
+	gs_atomic_store(&profiler->period_us, 0);
+	gs_atomic_store(&profiler->reset, 0);
+	profiler->last_start = 0.0;
+}
+
+void deadline_profiler_reset(deadline_profiler_t* profiler) {
+	gs_atomic_store(&profiler->reset, 1);
+}
+
+double deadline_profiler_begin(deadline_profiler_t* profiler) {
+	if (gs_atomic_load(&profiler->reset)) {
+		_deadline_profiler_clear(profiler);
+		gs_atomic_store(&profiler->reset, 0);
+	}
+	return gs_timer();
+}
+
+void deadline_profiler_end(deadline_profiler_t* profiler, double start, int num_frames, int sample_rate) {
+	const double now = gs_timer();
+	const double period = (double)num_frames / sample_rate;
+	if (period <= 0.0) return;
+
+	if (profiler->last_start > 0.0 && start - profiler->last_start > period * GS_PROFILER_LATE_PERIODS) {
+		gs_atomic_add(&profiler->late, 1);
+	}
+	profiler->last_start = start;
+
+	const double load = (now - start) / period;
+	const int32_t units = load * LOAD_UNITS < INT32_MAX ? (int32_t)(load * LOAD_UNITS) : INT32_MAX;
+
+	int bin = units / (LOAD_UNITS / 100);
+	if (bin >= GS_PROFILER_BINS) bin = GS_PROFILER_BINS - 1;
+	gs_atomic_add(&profiler->histogram[bin], 1);
+
+	// single writer, no compare-exchange needed
+	if (units < gs_atomic_load(&profiler->min_load)) gs_atomic_store(&profiler->min_load, units);
+	if (units > gs_atomic_load(&profiler->max_load)) gs_atomic_store(&profiler->max_load, units);
+	if (units > LOAD_UNITS) gs_atomic_add(&profiler->overruns, 1);
+
+	gs_atomic_store(&profiler->last_load, units);
+	gs_atomic_store(&profiler->period_us, (int32_t)(period * 1e6));
+	gs_atomic_add(&profiler->callbacks, 1);
+}
+
+void deadline_profiler_stats(deadline_profiler_t* profiler, deadline_stats_t* stats) {
+	int counts[GS_PROFILER_BINS];
+	int total = 0;
+	double sum = 0.0;
+	for (int i = 0; i < GS_PROFILER_BINS; i++) {
+		counts[i] = gs_atomic_load(&profiler->histogram[i]);
+		total += counts[i];
+		sum += counts[i] * (i + 0.5) * 0.01;
+	}
+
+	stats->callbacks = gs_atomic_load(&profiler->callbacks);
+	stats->overruns = gs_atomic_load(&profiler->overruns);
+	stats->late = gs_atomic_load(&profiler->late);
+	stats->max_load = (float)gs_atomic_load(&profiler->max_load) / LOAD_UNITS;
+	stats->last_load = (float)gs_atomic_load(&profiler->last_load) / LOAD_UNITS;
+	stats->period = gs_atomic_load(&profiler->period_us) * 1e-6;
+
+	const int32_t min_load = gs_atomic_load(&profiler->min_load);
+	stats->min_load = min_load == INT32_MAX ? 0.0f : (float)min_load / LOAD_UNITS;
+
+	stats->avg_load = total > 0 ? (float)(sum / total) : 0.0f;
+
+	// upper edge of the bin holding the 99th percentile
+	stats->p99_load = 0.0f;
+	const int target = total - total / 100;
+	int seen = 0;
+	for (int i = 0; i < GS_PROFILER_BINS && total > 0; i++) {
+		seen += counts[i];
+		if (seen >= target) {
+			stats->p99_load = (i + 1) * 0.01f;
+			break;
+		}
+	}
+}
+
+void deadline_profiler_log(const deadline_stats_t* stats, FILE* fp) {
+	fprintf(fp,
+		"callbacks %d, period %.2f ms, load min %.1f%% avg %.1f%% p99 %.1f%% max %.1f%%, overruns %d, late %d\n",
+		stats->callbacks, stats->period * 1000.0,
+		stats->min_load * 100.0f, stats->avg_load * 100.0f, stats->p99_load * 100.0f, stats->max_load * 100.0f,
+		stats->overruns, stats->late
+	);
+	fflush(fp);
+}
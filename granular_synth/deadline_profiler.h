@@ -0,0 +1,45 @@
+#ifndef DEADLINE_PROFILER_H
+#define DEADLINE_PROFILER_H
+
+#include <stdio.h>
+
+#include "platform.h"
+
+#define GS_PROFILER_BINS 200 // 1% of the buffer period per bin, the last one collects everything above
+#define GS_PROFILER_LATE_PERIODS 1.5 // a callback starting this many periods after the previous one counts as late
+
+// measures how much of its deadline (the buffer period) each audio callback uses
+// the audio thread is the only writer and never blocks, every field it publishes is an atomic
+// so the GUI can read the statistics at any time. loads are stored in 0.01% units
+
+typedef struct deadline_profiler_t {
+	gs_atomic32_t histogram[GS_PROFILER_BINS];
+	gs_atomic32_t callbacks;
+	gs_atomic32_t overruns; // rendering took longer than the period
+	gs_atomic32_t late; // the callback came too late, the device most likely ran dry
+	gs_atomic32_t min_load, max_load, last_load;
+	gs_atomic32_t period_us; // period of the last callback in microseconds
+	gs_atomic32_t reset; // set by deadline_profiler_reset, handled by the audio thread
+
+	double last_start; // audio thread only
+} deadline_profiler_t;
+
+typedef struct deadline_stats_t {
+	int callbacks, overruns, late;
+	float min_load, avg_load, p99_load, max_load, last_load; // render time / period, 1 = deadline
+	double period; // seconds
+} deadline_stats_t;
+
+void deadline_profiler_init(deadline_profiler_t* profiler);
+// asks the audio thread to clear the statistics at its next callback, safe from any thread
+void deadline_profiler_reset(deadline_profiler_t* profiler);
+
+// audio thread: call begin at the top of the callback and end with what it rendered
+double deadline_profiler_begin(deadline_profiler_t* profiler);
+void deadline_profiler_end(deadline_profiler_t* profiler, double start, int num_frames, int sample_rate);
+
+// any thread, avg and p99 come from the histogram and have its 1% resolution
+void deadline_profiler_stats(deadline_profiler_t* profiler, deadline_stats_t* stats);
+void deadline_profiler_log(const deadline_stats_t* stats, FILE* fp);
+
+#endif // !DEADLINE_PROFILER_H
@@ -1,9 +1,17 @@
 #include "granular_synth.h"
+#include "simd.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 #include <assert.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 float tunable_sigmoid_curve(float x, float k) {
 	k = fmaxf(-0.9999f, fminf(0.9999f, k));
@@ -85,6 +93,82 @@ void curve_free(curve_t* curve) {
 	smol_vector_free(&curve->points);
 }
 
+static void window_table_finish(window_table_t* table) {
+	table->attack[GS_WINDOW_TABLE_SIZE + 1] = table->attack[GS_WINDOW_TABLE_SIZE];
+	table->release[GS_WINDOW_TABLE_SIZE + 1] = table->release[GS_WINDOW_TABLE_SIZE];
+}
+
+void window_table_bake(window_table_t* table, grain_window_shape shape) {
+	const float sigma = 0.4f;
+	const float gaussian_floor = expf(-0.5f / (sigma * sigma));
+
+	for (int i = 0; i <= GS_WINDOW_TABLE_SIZE; i++) {
+		const float r = (float)i / GS_WINDOW_TABLE_SIZE;
+		float attack = 1.0f, release = 1.0f;
+
+		switch (shape) {
+			case GRAIN_WINDOW_SIGMOID: {
+				attack = tunable_sigmoid_curve(r, -0.5f);
+				release = 1.0f - 0.99f * attack;
+			} break;
+			case GRAIN_WINDOW_HANN: {
+				attack = 0.5f - 0.5f * cosf((float)M_PI * r);
+				release = 1.0f - attack;
+			} break;
+			case GRAIN_WINDOW_GAUSSIAN: {
+				// rescaled so the edges reach 0
+				const float a = (1.0f - r) / sigma;
+				const float b = r / sigma;
+				attack = (expf(-0.5f * a * a) - gaussian_floor) / (1.0f - gaussian_floor);
+				release = (expf(-0.5f * b * b) - gaussian_floor) / (1.0f - gaussian_floor);
+			} break;
+			case GRAIN_WINDOW_TRAPEZOID: {
+				attack = r;
+				release = 1.0f - r;
+			} break;
+			default: break; // GRAIN_WINDOW_CURVE holds at 1 until a curve is baked
+		}
+
+		table->attack[i] = attack;
+		table->release[i] = release;
+	}
+	window_table_finish(table);
+}
+
+void window_table_bake_curve(window_table_t* table, curve_t* curve) {
+	for (int i = 0; i <= GS_WINDOW_TABLE_SIZE; i++) {
+		const float r = (float)i / GS_WINDOW_TABLE_SIZE;
+		table->attack[i] = curve_get_value(curve, r * 0.5f);
+		table->release[i] = curve_get_value(curve, 0.5f + r * 0.5f);
+	}
+	window_table_finish(table);
+}
+
+// baked by whichever thread asks first, the others wait for it
+const window_table_t* window_table_default(void) {
+	static window_table_t table;
+	static gs_atomic32_t state = 0; // 0 not baked, 1 baking, 2 ready
+	if (gs_atomic_load_acquire(&state) != 2) {
+		if (gs_atomic_cas(&state, 0, 1) == 0) {
+			window_table_bake(&table, GRAIN_WINDOW_SIGMOID);
+			gs_atomic_store(&state, 2);
+		} else {
+			while (gs_atomic_load(&state) != 2) {
+				gs_cpu_pause();
+			}
+		}
+	}
+	return &table;
+}
+
+// r in [0, 1]
+static inline float window_ramp_lookup(const float* ramp, float r) {
+	const float x = r * GS_WINDOW_TABLE_SIZE;
+	const int index = (int)x;
+	const float t = x - (float)index;
+	return ramp[index] + (ramp[index + 1] - ramp[index]) * t;
+}
+
 void adsr_init(adsr_t* adsr) {
 	adsr->attack = 0.0f;
 	adsr->decay = 0.0f;
@@ -149,100 +233,282 @@ void adsr_update(adsr_t* adsr, float sample_rate) {
 	adsr->time += inv_sample_rate;
 }
 
-void grain_init(grain_t* grain) {
-	grain->size = 100;
-	grain->position = 0;
-	grain->pitch = 1.0f;
-	grain->velocity = 1.0f;
-	grain->time = 0.0f;
-	grain->play_mode = GRAIN_FORWARD;
-	grain->smoothness = 1.0f;
-	grain->state = GRAIN_IDLE;
+// bit scan/count helpers for the grain slot masks (same idea as smol_bsf in smol_audio.h)
+static inline int gs_bsf32(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
 }
 
-void grain_update(grain_t* grain, float sample_rate) {
-	switch (grain->state) {
-		case GRAIN_PLAYING: {
-			grain->computed_amplitude = grain->velocity;
-			grain->computed_pitch = grain->pitch;
+static inline int gs_popcount32(uint32_t mask) {
+	mask = mask - ((mask >> 1) & 0x55555555u);
+	mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+	return (int)((((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
 
-			float ntime = grain->time / grain->size;
-			float t = grain_get_time_factor(grain, ntime);
+#define GS_ALL_GRAINS_MASK (GS_GRAIN_CHUNK_SIZE == 32 ? 0xFFFFFFFFu : ((1u << GS_GRAIN_CHUNK_SIZE) - 1u))
 
-			// compute Attack/Decay envelope based on smoothness
-			// smoothness = 0.0 -> hold, 1.0 -> smooth
-			float factor = smol_clampf(grain->smoothness, 0.0f, 1.0f) * 0.5f;
+void grain_pool_init(grain_pool_t* pool) {
+	memset(pool, 0, sizeof(grain_pool_t));
+}
 
-			float amp = 1.0f;
-			if (t <= factor) {
-				float ratio = t / factor;
-				ratio = tunable_sigmoid_curve(ratio, -0.5f);
-				amp = smol_mixf(0.0f, 1.0f, ratio);
-			}
-			else if (t >= 1.0f - factor) {
-				float ratio = (t - (1.0f - factor)) / factor;
-				ratio = tunable_sigmoid_curve(ratio, -0.5f);
-				amp = smol_mixf(0.01f, 1.0f, 1.0f - ratio);
-			}
+void grain_pool_clear(grain_pool_t* pool) {
+	uint32_t mask = pool->active_mask;
+	while (mask) {
+		const int i = gs_bsf32(mask);
+		mask &= mask - 1;
+		pool->amplitude[i] = 0.0f;
+		pool->gain[i] = 0.0f;
+		pool->frames_left[i] = 0;
+	}
+	pool->active_mask = 0;
+}
 
-			grain->computed_amplitude *= amp;
-			grain->computed_time = (double)t * grain->size;
+int grain_bank_init(grain_bank_t* bank, int max_grains) {
+	const int num_chunks = max_grains > 0 ? (max_grains + GS_GRAIN_CHUNK_SIZE - 1) / GS_GRAIN_CHUNK_SIZE : 1;
 
-			if (grain_check_grain_end(grain, ntime)) {
-				grain->state = GRAIN_FINISHED;
-				grain->computed_time = 0.0;
-				grain->time = 0.0f;
-			}
-		} break;
-		default: break;
+	bank->chunks = malloc(sizeof(grain_pool_t) * num_chunks);
+	bank->num_chunks = bank->chunks ? num_chunks : 0;
+	bank->search_start = 0;
+
+	for (int i = 0; i < bank->num_chunks; i++) {
+		grain_pool_init(&bank->chunks[i]);
 	}
-	const double inv_sample_rate = 1.0 / sample_rate;
-	grain->time += inv_sample_rate * grain->computed_pitch;
+	return bank->num_chunks > 0;
 }
 
-int grain_is_free(grain_t* grain) {
-	return grain->state == GRAIN_IDLE || grain->state == GRAIN_FINISHED;
+void grain_bank_free(grain_bank_t* bank) {
+	free(bank->chunks);
+	bank->chunks = NULL;
+	bank->num_chunks = 0;
 }
 
-float grain_get_time_factor(grain_t* grain, float ntime) {
-	switch (grain->play_mode) {
-		case GRAIN_FORWARD: {
-			return ntime;
-		} break;
-		case GRAIN_REVERSE: {
-			return 1.0f - ntime;
-		} break;
-		case GRAIN_PINGPONG: {
-			float t = fmodf(ntime, 2.0f);
-			if (t > 1.0f) {
-				t = 2.0f - t;
-			}
-			return t;
-		} break;
-		default: return 0.0f;
+grain_pool_t* grain_bank_acquire(grain_bank_t* bank) {
+	// start where the last chunk was taken, the chunks before it are likely still borrowed
+	const int start = gs_atomic_load(&bank->search_start);
+	for (int n = 0; n < bank->num_chunks; n++) {
+		const int i = (start + n) % bank->num_chunks;
+		grain_pool_t* chunk = &bank->chunks[i];
+		if (gs_atomic_load(&chunk->in_use) == 0 && gs_atomic_cas(&chunk->in_use, 0, 1) == 0) {
+			gs_atomic_store(&bank->search_start, (i + 1) % bank->num_chunks);
+			return chunk;
+		}
 	}
+	return NULL;
+}
+
+void grain_bank_release(grain_pool_t* chunk) {
+	grain_pool_clear(chunk);
+	gs_atomic_store(&chunk->in_use, 0);
 }
 
-int grain_check_grain_end(grain_t* grain, float ntime) {
-	switch (grain->play_mode) {
-		case GRAIN_FORWARD:
-		case GRAIN_REVERSE: return ntime >= 1.0f;
-		case GRAIN_PINGPONG: return ntime >= 2.0f;
-		default: return 0;
+int grain_pool_spawn(
+	grain_pool_t* pool, grain_play_mode play_mode,
+	double position, double size,
+	float pitch, float velocity,
+	const window_table_t* window, float smoothness,
+	float source_rate, float sample_rate
+) {
+	if (size <= 0.0 || pitch <= 0.0f || source_rate <= 0.0f) {
+		return -1;
 	}
+
+	if (pool->active_mask == GS_ALL_GRAINS_MASK) {
+		return -1;
+	}
+	const int index = gs_bsf32(~pool->active_mask);
+
+	const double start = position * source_rate;
+	const double length = size * source_rate; // in source frames
+	const double step = (double)pitch * ((double)source_rate / sample_rate); // source frames per output frame
+	const double phase_increment = step / length;
+
+	// ping-pong grains travel the segment twice
+	const double phase_span = play_mode == GRAIN_PINGPONG ? 2.0 : 1.0;
+	const double frames = ceil(phase_span / phase_increment);
+
+	// smoothness = 0.0 -> hold, 1.0 -> smooth
+	const float width = fmaxf(smol_clampf(smoothness, 0.0f, 1.0f) * 0.5f, 1e-6f);
+
+	const int64_t start_position = llround(start * GS_POSITION_ONE);
+	const int64_t end_position = llround((start + length) * GS_POSITION_ONE);
+	const int64_t increment = llround(step * GS_POSITION_ONE);
+
+	if (play_mode == GRAIN_REVERSE) {
+		pool->position[index] = end_position;
+		pool->increment[index] = -increment;
+		pool->phase[index] = 1.0f;
+		pool->phase_increment[index] = (float)-phase_increment;
+	} else {
+		pool->position[index] = start_position;
+		pool->increment[index] = increment;
+		pool->phase[index] = 0.0f;
+		pool->phase_increment[index] = (float)phase_increment;
+	}
+	pool->turn_position[index] = end_position;
+	pool->turn_phase[index] = play_mode == GRAIN_PINGPONG ? 1.0f : FLT_MAX;
+
+	pool->amplitude[index] = velocity;
+	pool->window[index] = window ? window : window_table_default();
+	pool->window_width[index] = width;
+	pool->window_scale[index] = 1.0f / width;
+	pool->gain[index] = 0.0f;
+	pool->frames_left[index] = frames < INT32_MAX ? (int32_t)frames : INT32_MAX;
+	pool->active_mask |= 1u << index;
+
+	return index;
 }
 
-void grain_render_channel(grain_t* grain, smol_audiobuffer_t* buffer, int channel, float* out) {
-	if (grain->state != GRAIN_PLAYING) {
-		*out = 0.0f;
-		return;
+int grain_pool_is_playing(grain_pool_t* pool, int index) {
+	return (pool->active_mask >> index) & 1u;
+}
+
+int grain_pool_active_count(grain_pool_t* pool) {
+	return gs_popcount32(pool->active_mask);
+}
+
+void grain_pool_render_frame(grain_pool_t* pool, sample_source_t* source, float* out, int num_channels) {
+	// mono (or narrower) sources are spread over the remaining channels
+	int source_offset[GS_MAX_CHANNELS];
+	const float* plane[GS_MAX_CHANNELS];
+	const uint16_t* plane16[GS_MAX_CHANNELS];
+	for (int channel = 0; channel < num_channels; channel++) {
+		source_offset[channel] = channel < source->num_channels ? channel : source->num_channels - 1;
+		plane[channel] = (const float*)source->planes[source_offset[channel]];
+		plane16[channel] = (const uint16_t*)source->planes[source_offset[channel]];
+	}
+	const int planar = source->planes[0] != NULL;
+	// int16 and half float planes are gathered as is and widened four lanes at a time
+	const sample_store store = planar ? source->store_format : SAMPLE_STORE_F32;
+	float scratch[2 * GS_SAMPLE_MAX_CHANNELS];
+
+	gs_f4 accum[GS_MAX_CHANNELS];
+	for (int channel = 0; channel < num_channels; channel++) {
+		accum[channel] = gs_f4_zero();
+	}
+
+	// only visit lane groups that hold at least one playing grain
+	const uint32_t lane_group = (1u << GS_SIMD_WIDTH) - 1u;
+	uint32_t groups = pool->active_mask;
+	while (groups) {
+		const int base = gs_bsf32(groups) & ~(GS_SIMD_WIDTH - 1);
+		const uint32_t lanes = (pool->active_mask >> base) & lane_group;
+		groups &= ~(lane_group << base);
+
+		// gather the interpolation taps, the read position is shared by every channel
+		float fraction[GS_SIMD_WIDTH];
+		float tap_a[GS_MAX_CHANNELS][GS_SIMD_WIDTH];
+		float tap_b[GS_MAX_CHANNELS][GS_SIMD_WIDTH];
+		uint16_t tap16_a[GS_MAX_CHANNELS][GS_SIMD_WIDTH];
+		uint16_t tap16_b[GS_MAX_CHANNELS][GS_SIMD_WIDTH];
+		float window[GS_SIMD_WIDTH];
+
+		for (int lane = 0; lane < GS_SIMD_WIDTH; lane++) {
+			const int i = base + lane;
+			if (!(lanes & (1u << lane))) {
+				// a finished grain keeps its stale position, it must not touch (or page in) the sample
+				window[lane] = 0.0f;
+				fraction[lane] = 0.0f;
+				for (int channel = 0; channel < num_channels; channel++) {
+					tap_a[channel][lane] = tap_b[channel][lane] = 0.0f;
+					tap16_a[channel][lane] = tap16_b[channel][lane] = 0;
+				}
+				continue;
+			}
+
+			// attack ramp up to window_width, then the release ramp over the last window_width of the grain
+			const float phase = pool->phase[i];
+			const float width = pool->window_width[i];
+			const int attack = phase <= width;
+			const float r = (attack ? phase : phase - (1.0f - width)) * pool->window_scale[i];
+			const window_table_t* table = pool->window[i];
+			window[lane] = window_ramp_lookup(attack ? table->attack : table->release, smol_clampf(r, 0.0f, 1.0f));
+
+			const int64_t position = pool->position[i];
+			const int64_t index = GS_POSITION_FRAME(position);
+
+			// top 24 bits of the fraction convert to float exactly
+			fraction[lane] = (float)((uint32_t)position >> 8) * (1.0f / 16777216.0f);
+
+			if (planar) {
+				// the guard frames stand in for everything outside the sample, no tap is checked
+				const int64_t tap = sample_source_clamp(source, index);
+				if (store == SAMPLE_STORE_F32) {
+					for (int channel = 0; channel < num_channels; channel++) {
+						tap_a[channel][lane] = plane[channel][tap];
+						tap_b[channel][lane] = plane[channel][tap + 1];
+					}
+				} else {
+					for (int channel = 0; channel < num_channels; channel++) {
+						tap16_a[channel][lane] = plane16[channel][tap];
+						tap16_b[channel][lane] = plane16[channel][tap + 1];
+					}
+				}
+			} else {
+				const float* a;
+				const float* b;
+				sample_source_pair(source, index, &a, &b, scratch);
+				for (int channel = 0; channel < num_channels; channel++) {
+					tap_a[channel][lane] = a ? a[source_offset[channel]] : 0.0f;
+					tap_b[channel][lane] = b ? b[source_offset[channel]] : 0.0f;
+				}
+			}
+		}
+
+		const gs_f4 gain = gs_f4_mul(gs_f4_load(window), gs_f4_load(&pool->amplitude[base]));
+		gs_f4_store(&pool->gain[base], gain);
+
+		const gs_f4 t = gs_f4_load(fraction);
+		for (int channel = 0; channel < num_channels; channel++) {
+			gs_f4 a, b;
+			if (store == SAMPLE_STORE_S16) {
+				a = gs_f4_mul(gs_f4_load_s16((const int16_t*)tap16_a[channel]), gs_f4_set1(1.0f / 32768.0f));
+				b = gs_f4_mul(gs_f4_load_s16((const int16_t*)tap16_b[channel]), gs_f4_set1(1.0f / 32768.0f));
+			} else if (store == SAMPLE_STORE_F16) {
+				a = gs_f4_load_f16(tap16_a[channel]);
+				b = gs_f4_load_f16(tap16_b[channel]);
+			} else {
+				a = gs_f4_load(tap_a[channel]);
+				b = gs_f4_load(tap_b[channel]);
+			}
+			const gs_f4 value = gs_f4_add(a, gs_f4_mul(gs_f4_sub(b, a), t));
+			accum[channel] = gs_f4_add(accum[channel], gs_f4_mul(value, gain));
+		}
+
+		// advance
+		const gs_f4 next_phase = gs_f4_add(gs_f4_load(&pool->phase[base]), gs_f4_load(&pool->phase_increment[base]));
+		gs_f4_store(&pool->phase[base], next_phase);
+
+		const int turning = gs_m4_any(gs_f4_cmpgt(next_phase, gs_f4_load(&pool->turn_phase[base])));
+
+		for (int lane = 0; lane < GS_SIMD_WIDTH; lane++) {
+			const int i = base + lane;
+			if (!(lanes & (1u << lane))) continue;
+
+			pool->position[i] += pool->increment[i];
+
+			if (--pool->frames_left[i] == 0) {
+				pool->amplitude[i] = 0.0f;
+				pool->gain[i] = 0.0f;
+				pool->active_mask &= ~(1u << i);
+			} else if (turning && pool->phase[i] > pool->turn_phase[i]) {
+				// ping-pong: reflect around the end of the segment and play it backwards
+				pool->phase[i] = 2.0f - pool->phase[i];
+				pool->phase_increment[i] = -pool->phase_increment[i];
+				pool->position[i] = 2 * pool->turn_position[i] - pool->position[i];
+				pool->increment[i] = -pool->increment[i];
+				pool->turn_phase[i] = FLT_MAX;
+			}
+		}
 	}
 
-	*out = smol_audiobuffer_sample_linear(
-		buffer,
-		channel,
-		grain->computed_time + grain->position
-	) * grain->computed_amplitude;
+	for (int channel = 0; channel < num_channels; channel++) {
+		out[channel] += gs_f4_hsum(accum[channel]);
+	}
 }
 
 void voice_init(voice_t* voice, int sample_rate) {
@@ -250,15 +516,22 @@ void voice_init(voice_t* voice, int sample_rate) {
 	voice->grain_settings.position = 0.0f;
 	voice->grain_settings.size = 0.1f;
 	voice->grain_settings.smoothness = 1.0f;
+	voice->grain_settings.window = window_table_default();
 	voice->note_settings.pitch = 1.0f;
 	voice->note_settings.velocity = 1.0f;
 	voice->grain_spawn_timer = 0.0f;
+	gs_rng_seed(&voice->rng, GS_DEFAULT_SEED);
 	voice->state = VOICE_IDLE;
+	voice->source = NULL;
+	voice->sample_epoch = 0;
+	voice->fade_gain = 1.0f;
+	voice->fade_step = 0.0f;
+	voice->fade_frames = 0;
+	voice->pending_note.active = 0;
+	voice->sustained = 0;
+
+	voice->num_grain_chunks = 0;
 
-	for (size_t i = 0; i < GS_VOICE_MAX_GRAINS; i++) {
-		grain_init(&voice->grains[i]);
-	}
-	
 	adsr_init(&voice->amplitude_envelope);
 	voice->amplitude_envelope.attack = 0.2f;
 	voice->amplitude_envelope.decay = 0.0f;
@@ -278,49 +551,69 @@ void voice_init(voice_t* voice, int sample_rate) {
 	voice->lowpass_filter_envelope.release = 1.5f;
 }
 
-grain_t* voice_get_free_grain(voice_t* voice) {
-	for (size_t i = 0; i < GS_VOICE_MAX_GRAINS; i++) {
-		grain_t* current = &voice->grains[i];
-		if (grain_is_free(current)) {
-			return current;
-		}
-	}
-	return NULL;
-}
-
-void voice_spawn_grain(voice_t* voice) {
-	grain_t* grain = voice_get_free_grain(voice);
-	if (grain == NULL) {
-		return;
-	}
-
-	grain_init(grain);
-	grain->size = voice->grain_settings.size;
-	grain->position = voice->grain_settings.position; // start position in the buffer
-	grain->smoothness = voice->grain_settings.smoothness;
-	grain->pitch = voice->note_settings.pitch;
-	grain->velocity = voice->note_settings.velocity;
-	grain->play_mode = GRAIN_FORWARD;
-	grain->state = GRAIN_PLAYING;
-
+void voice_spawn_grain(voice_t* voice, const sample_source_t* source, float sample_rate) {
+	grain_play_mode play_mode = GRAIN_FORWARD;
 	switch (voice->grain_settings.play_mode) {
-		case GS_PLAY_FORWARD: grain->play_mode = GRAIN_FORWARD; break;
-		case GS_PLAY_REVERSE: grain->play_mode = GRAIN_REVERSE; break;
-		case GS_PLAY_PINGPONG: grain->play_mode = GRAIN_PINGPONG; break;
+		case GS_PLAY_FORWARD: play_mode = GRAIN_FORWARD; break;
+		case GS_PLAY_REVERSE: play_mode = GRAIN_REVERSE; break;
+		case GS_PLAY_PINGPONG: play_mode = GRAIN_PINGPONG; break;
 		case GS_PLAY_RANDOM_BACK_AND_FORTH: {
-			grain->play_mode = smol_rnd(0, 100) > 50 ? GRAIN_FORWARD : GRAIN_REVERSE;
+			play_mode = gs_rng_float(&voice->rng) < 0.5f ? GRAIN_FORWARD : GRAIN_REVERSE;
 		} break;
 	}
 
 	// apply random size
-	grain->size += smol_randf(
-		-voice->random_settings.size_random,
-		voice->random_settings.size_random
-	);
+	double size = voice->grain_settings.size;
+	size += gs_rng_range(&voice->rng, 0.0f, (float)voice->random_settings.size_random);
 
 	// apply random position offset in %
-	double offset = voice->random_settings.position_offset_random * grain->size;
-	grain->position += smol_randf(-offset, offset);
+	double position = voice->grain_settings.position; // start position in the buffer
+	const float offset = voice->random_settings.position_offset_random * (float)size;
+	position += gs_rng_range(&voice->rng, -offset, offset);
+
+	// use the first chunk with a free slot, borrow another one when they are all full
+	grain_pool_t* chunk = NULL;
+	for (int i = 0; i < voice->num_grain_chunks; i++) {
+		if (voice->grains[i]->active_mask != GS_ALL_GRAINS_MASK) {
+			chunk = voice->grains[i];
+			break;
+		}
+	}
+	if (!chunk && voice->grain_bank && voice->num_grain_chunks < GS_VOICE_MAX_CHUNKS) {
+		chunk = grain_bank_acquire(voice->grain_bank);
+		if (chunk) {
+			voice->grains[voice->num_grain_chunks++] = chunk;
+		}
+	}
+	if (!chunk) {
+		return;
+	}
+
+	grain_pool_spawn(
+		chunk, play_mode,
+		position, size,
+		voice->note_settings.pitch,
+		voice->note_settings.velocity,
+		voice->grain_settings.window,
+		voice->grain_settings.smoothness,
+		(float)source->sample_rate, sample_rate
+	);
+}
+
+void voice_release_grains(voice_t* voice) {
+	for (int i = 0; i < voice->num_grain_chunks; i++) {
+		grain_bank_release(voice->grains[i]);
+	}
+	voice->num_grain_chunks = 0;
+}
+
+void voice_fade_out(voice_t* voice, float sample_rate) {
+	if (voice->fade_frames == 0) {
+		// counted in frames so render_block knows the frame the voice goes idle at
+		const long frames = lroundf(GS_STEAL_FADE_TIME * sample_rate);
+		voice->fade_frames = frames > 1 ? (int)frames : 1;
+		voice->fade_step = 1.0f / voice->fade_frames;
+	}
 }
 
 int voice_is_free(voice_t* voice) {
@@ -337,53 +630,86 @@ void voice_gate(voice_t* voice, int gate) {
 	}
 }
 
-void voice_render_channel(voice_t* voice, smol_audiobuffer_t* buffer, int channel, float* out) {
-	float accum = 0.0f;
-	for (size_t i = 0; i < GS_VOICE_MAX_GRAINS; i++) {
-		grain_t* grain = &voice->grains[i];
-		if (grain_is_free(grain)) continue;
-
-		float val = 0.0f;
-		grain_render_channel(grain, buffer, channel, &val);
-		accum += val;
+void voice_render_frame(voice_t* voice, sample_source_t* source, float* out, int num_channels) {
+	float accum[GS_MAX_CHANNELS] = { 0.0f };
+	for (int i = 0; i < voice->num_grain_chunks; i++) {
+		grain_pool_render_frame(voice->grains[i], source, accum, num_channels);
 	}
 
-	// apply filters
-	filter_t* filter = &voice->lowpass_filter[channel];
-	if (filter->process) {
-		accum = filter_process(filter, accum, voice->lowpass_filter_envelope.value);
-	}
+	for (int channel = 0; channel < num_channels; channel++) {
+		float value = accum[channel];
 
-	*out = accum * voice->amplitude_envelope.value;
+		// apply filters
+		filter_t* filter = &voice->lowpass_filter[channel];
+		if (filter->process) {
+			value = filter_process(filter, value, voice->lowpass_filter_envelope.value);
+		}
+
+		out[channel] = value * voice->amplitude_envelope.value * voice->fade_gain;
+	}
 }
 
-void voice_advance(voice_t* voice, float sample_rate) {
+void voice_advance(voice_t* voice, const sample_source_t* source, float sample_rate) {
 	const double inv_sample_rate = 1.0 / sample_rate;
 
 	if (!voice_is_free(voice)) {
 		voice->grain_spawn_timer += inv_sample_rate;
 		if (voice->grain_spawn_timer >= 1.0f / voice->grain_settings.grains_per_second) {
 			voice->grain_spawn_timer = 0.0f;
-			voice_spawn_grain(voice);
+			voice_spawn_grain(voice, source, sample_rate);
 		}
 	}
 
-	int all_grains_finished = 1;
-	for (size_t i = 0; i < GS_VOICE_MAX_GRAINS; i++) {
-		grain_t* grain = &voice->grains[i];
-		if (grain_is_free(grain)) continue;
-		grain_update(grain, sample_rate);
-		all_grains_finished = 0;
+	// grains advance as they are rendered, chunks that ran empty go back to the bank
+	for (int i = 0; i < voice->num_grain_chunks; i++) {
+		if (voice->grains[i]->active_mask == 0) {
+			grain_bank_release(voice->grains[i]);
+			voice->grains[i--] = voice->grains[--voice->num_grain_chunks];
+		}
 	}
+	int all_grains_finished = voice->num_grain_chunks == 0;
 
 	adsr_update(&voice->amplitude_envelope, sample_rate);
 	adsr_update(&voice->lowpass_filter_envelope, sample_rate);
 
+	if (voice->fade_frames > 0) {
+		voice->fade_gain -= voice->fade_step;
+		if (--voice->fade_frames == 0) {
+			voice->fade_gain = 0.0f;
+			voice->fade_step = 0.0f;
+			voice->amplitude_envelope.state = ADSR_IDLE;
+			voice->lowpass_filter_envelope.state = ADSR_IDLE;
+		}
+	}
+
+	// a free voice is silent and no longer rendered, its grains are not needed anymore
+	if (voice->amplitude_envelope.state == ADSR_IDLE) {
+		voice_release_grains(voice);
+		all_grains_finished = 1;
+	}
+
 	if (all_grains_finished && voice->amplitude_envelope.state == ADSR_IDLE) {
 		voice->state = VOICE_IDLE;
 	}
 }
 
+void voice_render_block(voice_t* voice, sample_source_t* source, float** out, int num_channels, int num_frames, float sample_rate) {
+	if (num_channels > GS_MAX_CHANNELS) {
+		num_channels = GS_MAX_CHANNELS;
+	}
+
+	for (int frame = 0; frame < num_frames; frame++) {
+		float value[GS_MAX_CHANNELS];
+		voice_render_frame(voice, source, value, num_channels);
+
+		for (int channel = 0; channel < num_channels; channel++) {
+			out[channel][frame] += value[channel];
+		}
+
+		voice_advance(voice, source, sample_rate);
+	}
+}
+
 float filter_init(filter_t* filter, int sample_rate) {
 	filter->params = NULL;
 	filter->process = NULL;
@@ -415,93 +741,781 @@ void filter_lowpass_init(filter_t* filter, int sample_rate, filter_lowpass_param
 	filter->process = _filter_lowpass_process;
 }
 
-void granular_synth_init(granular_synth_t* synth, int sample_rate, const char* sample_file) {
-	synth->sample.buffer = smol_create_audiobuffer_from_wav_file(sample_file);
-	synth->sample.window_start = 0.0f;
-	synth->sample.window_end = synth->sample.buffer.duration;
+static void voice_allocator_init(voice_allocator_t* allocator) {
+	// voice 0 is handed out first
+	allocator->num_free = 0;
+	for (int i = GS_SYNTH_MAX_VOICES - 1; i >= 0; i--) {
+		allocator->free_voices[allocator->num_free++] = i;
+		allocator->mapped[i] = 0;
+	}
+
+	allocator->oldest = allocator->newest = -1;
+
+	for (int i = 0; i < GS_VOICE_MAP_SIZE; i++) {
+		allocator->map_head[i] = -1;
+	}
+}
+
+static void voice_allocator_push_newest(voice_allocator_t* allocator, int index) {
+	allocator->prev[index] = allocator->newest;
+	allocator->next[index] = -1;
+	if (allocator->newest >= 0) {
+		allocator->next[allocator->newest] = index;
+	} else {
+		allocator->oldest = index;
+	}
+	allocator->newest = index;
+}
+
+static void voice_allocator_unlink(voice_allocator_t* allocator, int index) {
+	const int prev = allocator->prev[index], next = allocator->next[index];
+	if (prev >= 0) allocator->next[prev] = next; else allocator->oldest = next;
+	if (next >= 0) allocator->prev[next] = prev; else allocator->newest = prev;
+}
+
+static void voice_allocator_map(voice_allocator_t* allocator, int index, uint32_t id) {
+	const int bucket = id & (GS_VOICE_MAP_SIZE - 1);
+	allocator->map_key[index] = id;
+	allocator->map_next[index] = allocator->map_head[bucket];
+	allocator->map_head[bucket] = index;
+	allocator->mapped[index] = 1;
+}
+
+static void voice_allocator_unmap(voice_allocator_t* allocator, int index) {
+	if (!allocator->mapped[index]) return;
+
+	int* link = &allocator->map_head[allocator->map_key[index] & (GS_VOICE_MAP_SIZE - 1)];
+	while (*link != index) {
+		link = &allocator->map_next[*link];
+	}
+	*link = allocator->map_next[index];
+	allocator->mapped[index] = 0;
+}
+
+static int voice_allocator_find(voice_allocator_t* allocator, uint32_t id) {
+	for (int i = allocator->map_head[id & (GS_VOICE_MAP_SIZE - 1)]; i >= 0; i = allocator->map_next[i]) {
+		if (allocator->map_key[i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// voices go idle on the audio thread, they are put back on the free list once it runs dry
+static void _granular_synth_reclaim_voices(granular_synth_t* synth) {
+	voice_allocator_t* allocator = &synth->voice_allocator;
+
+	int index = allocator->oldest;
+	while (index >= 0) {
+		const int next = allocator->next[index];
+		voice_t* voice = &synth->voices[index];
+		if (voice_is_free(voice) && !voice->pending_note.active) {
+			voice_allocator_unlink(allocator, index);
+			voice_allocator_unmap(allocator, index);
+			allocator->free_voices[allocator->num_free++] = index;
+		}
+		index = next;
+	}
+}
+
+static int _granular_synth_pick_victim(granular_synth_t* synth) {
+	voice_allocator_t* allocator = &synth->voice_allocator;
+	if (allocator->steal_policy == GS_STEAL_NONE) {
+		return -1;
+	}
+
+	// voices that are already fading out are taken last, voices with a stolen note waiting never
+	int victim = -1, fading = -1;
+	float quietest = FLT_MAX;
+	for (int i = allocator->oldest; i >= 0; i = allocator->next[i]) {
+		voice_t* voice = &synth->voices[i];
+		if (voice->pending_note.active) continue;
+		if (voice->fade_frames > 0) {
+			if (fading < 0) fading = i;
+			continue;
+		}
+
+		if (allocator->steal_policy != GS_STEAL_QUIETEST) {
+			victim = i;
+			break;
+		}
+
+		const float level = voice->amplitude_envelope.value * voice->note_settings.velocity;
+		if (level < quietest) {
+			quietest = level;
+			victim = i;
+		}
+	}
+
+	return victim >= 0 ? victim : fading;
+}
+
+static void _granular_synth_start_voice(granular_synth_t* synth, voice_t* voice, uint32_t id, float pitch, float velocity) {
+	voice_release_grains(voice);
+	voice_init(voice, synth->sample_rate);
+	voice->id = id;
+	voice->source = synth->sample.source;
+	voice->sample_epoch = synth->sample.epoch;
+	const uint64_t seed = (uint64_t)gs_rng_next(&synth->rng) << 32;
+	gs_rng_seed(&voice->rng, seed | gs_rng_next(&synth->rng));
+	voice->note_settings.pitch = pitch + synth->tuning;
+	voice->note_settings.velocity = velocity;
+	voice->grain_settings.position = synth->sample.window_start;
+	voice->grain_settings.size = synth->sample.window_end - synth->sample.window_start;
+	voice->grain_settings.grains_per_second = synth->grain_settings.grains_per_second;
+	voice->grain_settings.smoothness = synth->grain_settings.grain_smoothness;
+	voice->grain_settings.window = &synth->window_tables[synth->grain_settings.window_shape];
+	voice->grain_settings.play_mode = synth->grain_settings.play_mode;
+	voice->grain_spawn_timer = voice->grain_settings.grains_per_second;
+	voice->random_settings.size_random = synth->random_settings.size_random;
+	voice->random_settings.position_offset_random = synth->random_settings.position_offset_random;
+	
+	voice_gate(voice, 1);
+}
 
+// the voice fades out and the note starts on it at the frame after the fade ends
+static void _granular_synth_steal_voice(granular_synth_t* synth, int index, uint32_t id, float pitch, float velocity) {
+	voice_allocator_t* allocator = &synth->voice_allocator;
+	voice_t* voice = &synth->voices[index];
+
+	voice_allocator_unmap(allocator, index);
+	voice_allocator_map(allocator, index, id);
+	voice_allocator_unlink(allocator, index);
+	voice_allocator_push_newest(allocator, index);
+
+	voice->pending_note.id = id;
+	voice->pending_note.pitch = pitch;
+	voice->pending_note.velocity = velocity;
+	voice->pending_note.active = 1;
+	voice->sustained = 0; // belonged to the old note
+	voice_fade_out(voice, synth->sample_rate);
+}
+
+int granular_synth_init(granular_synth_t* synth, int sample_rate, const char* sample_file) {
+	// the grain bank and the reverb free (and the reverb reuses) whatever they find, start from nothing
+	memset(synth, 0, sizeof(granular_synth_t));
+	synth->sample_rate = sample_rate;
 	synth->grain_settings.grains_per_second = 10;
 	synth->grain_settings.grain_smoothness = 1.0f;
+	synth->grain_settings.window_shape = GRAIN_WINDOW_SIGMOID;
+
+	for (int i = 0; i < GRAIN_WINDOW_COUNT; i++) {
+		window_table_bake(&synth->window_tables[i], (grain_window_shape)i);
+	}
 
 	synth->random_settings.size_random = 0.0f;
 	synth->random_settings.position_offset_random = 0.0f;
 
 	synth->tuning = 0.0f;
 
+	int result = grain_bank_init(&synth->grain_bank, GS_DEFAULT_MAX_GRAINS);
+
+	voice_allocator_init(&synth->voice_allocator);
+	synth->voice_allocator.steal_policy = GS_STEAL_OLDEST;
+
 	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
 		voice_init(&synth->voices[i], sample_rate);
+		synth->voices[i].grain_bank = &synth->grain_bank;
+	}
+
+	// every state gets an arena sized for the high tier, so switching tiers later never allocates
+	for (int i = 0; i < GS_REVERB_STATES; i++) {
+		if (!sf_presetreverb(&synth->reverbs[i], sample_rate, SF_REVERB_PRESET_LONGREVERB1)) {
+			result = 0;
+		}
 	}
+	synth->reverb_quality = synth->reverbs[0].quality;
+	synth->reverb_current = 0;
+	synth->reverb_fading = -1;
+	synth->reverb_fade_length = (int)(GS_REVERB_FADE_TIME * sample_rate);
+	if (synth->reverb_fade_length < 1) {
+		synth->reverb_fade_length = 1;
+	}
+	gs_atomic_store(&synth->reverb_slots, 1 << synth->reverb_current);
+
+	synth->workers.num_workers = 0;
+
+	memset(&synth->telemetry, 0, sizeof(synth_telemetry_t));
+	synth->telemetry.back = 0;
+	synth->telemetry.middle = 1;
+	synth->telemetry.front = 2;
+
+	event_queue_init(&synth->events);
+	synth->clock.time = synth->clock.previous_time = 0.0;
+	synth->clock.frame = 0;
+	synth->frame_count = 0;
+	synth->sustain = 0;
+
+	granular_synth_set_seed(synth, GS_DEFAULT_SEED);
 
-	sf_presetreverb(&synth->reverb_filter, sample_rate, SF_REVERB_PRESET_LONGREVERB1);
+	sample_manager_init(&synth->sample.manager);
+	granular_synth_load_sample(synth, sample_file, SAMPLE_LOAD_RESIDENT);
+	return result;
 }
 
-void granular_synth_render_channel(granular_synth_t* synth, int channel, float* out) {
-	float accum = 0.0f;
+// picks up the current sample at the start of a block. voices keep the sample they started on, so the
+// audio thread holds the oldest epoch a playing voice started in, or the current one
+static void _granular_synth_acquire_sample(granular_synth_t* synth) {
+	sample_manager_t* manager = &synth->sample.manager;
+	const int32_t epoch = sample_manager_epoch(manager);
+	int32_t held = epoch;
 	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
 		voice_t* voice = &synth->voices[i];
 		if (voice_is_free(voice)) continue;
-
-		float val = 0.0f;
-		voice_render_channel(voice, &synth->sample.buffer, channel, &val);
-		accum += val;
-		assert(accum == accum);
+		if ((int32_t)((uint32_t)voice->sample_epoch - (uint32_t)held) < 0) {
+			held = voice->sample_epoch;
+		}
 	}
+	sample_manager_hold(manager, GS_SAMPLE_READER_AUDIO, held);
+	synth->sample.source = sample_manager_current(manager);
+	synth->sample.epoch = epoch;
+}
 
-	// apply reverb
-	sf_sample_st in_rev, out_rev;
-	in_rev.L = in_rev.R = accum;
+int granular_synth_load_sample(granular_synth_t* synth, const char* sample_file, sample_load_mode mode) {
+	const int32_t id = sample_manager_load(&synth->sample.manager, sample_file, mode);
+	const int result = sample_manager_wait(&synth->sample.manager, id) == 1;
+	_granular_synth_acquire_sample(synth);
+	synth->sample.window_start = 0.0;
+	synth->sample.window_end = synth->sample.source->duration;
+	return result;
+}
+
+int32_t granular_synth_load_sample_async(granular_synth_t* synth, const char* sample_file, sample_load_mode mode) {
+	return sample_manager_load(&synth->sample.manager, sample_file, mode);
+}
 
-	sf_reverb_process(&synth->reverb_filter, 1, &in_rev, &out_rev);
+int granular_synth_sample_status(granular_synth_t* synth, int32_t id) {
+	return sample_manager_status(&synth->sample.manager, id);
+}
 
-	*out = out_rev.L;
+void granular_synth_set_seed(granular_synth_t* synth, uint64_t seed) {
+	gs_rng_seed(&synth->rng, seed);
 }
 
-void granular_synth_advance(granular_synth_t* synth) {
+int granular_synth_set_max_grains(granular_synth_t* synth, int max_grains) {
+	grain_bank_free(&synth->grain_bank);
+	const int result = grain_bank_init(&synth->grain_bank, max_grains);
+
 	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+		voice_init(&synth->voices[i], synth->sample_rate);
+	}
+	voice_allocator_init(&synth->voice_allocator);
+	return result;
+}
+
+int granular_synth_start_workers(granular_synth_t* synth, int num_workers) {
+	granular_synth_stop_workers(synth);
+	if (num_workers <= 0) {
+		return 0;
+	}
+	return worker_pool_init(&synth->workers, num_workers);
+}
+
+void granular_synth_stop_workers(granular_synth_t* synth) {
+	if (synth->workers.num_workers > 0) {
+		worker_pool_free(&synth->workers);
+	}
+}
+
+void granular_synth_free(granular_synth_t* synth) {
+	granular_synth_stop_workers(synth);
+	grain_bank_free(&synth->grain_bank);
+	for (int i = 0; i < GS_REVERB_STATES; i++) {
+		sf_reverb_free(&synth->reverbs[i]);
+	}
+	sample_manager_free(&synth->sample.manager);
+	synth->sample.source = NULL;
+}
+
+void granular_synth_set_reverb_quality(granular_synth_t* synth, sf_reverb_quality quality) {
+	if (quality == synth->reverb_quality) {
+		return;
+	}
+	synth->reverb_quality = quality;
+
+	// take back a tier render_block has not picked up yet, or else build in a state it plays neither of
+	// (with nothing pending it can only release states, so a free one stays free)
+	int index = 0;
+	int32_t slots = gs_atomic_load(&synth->reverb_slots);
+	while (slots >> GS_REVERB_PENDING_SHIFT) {
+		const int32_t previous = gs_atomic_cas(&synth->reverb_slots, slots, slots & ((1 << GS_REVERB_PENDING_SHIFT) - 1));
+		if (previous == slots) {
+			break;
+		}
+		slots = previous;
+	}
+	if (slots >> GS_REVERB_PENDING_SHIFT) {
+		index = (slots >> GS_REVERB_PENDING_SHIFT) - 1;
+	} else {
+		while (slots & (1 << index)) {
+			index++;
+		}
+	}
+
+	// rebuilding clears the delay lines, the new tier starts silent and render_block fades it in
+	sf_reverb_set_quality(&synth->reverbs[index], quality);
+	// only this function fills the pending field, so adding sets it without disturbing the busy bits
+	gs_atomic_add(&synth->reverb_slots, (index + 1) << GS_REVERB_PENDING_SHIFT);
+}
+
+static void _granular_synth_acquire_reverb(granular_synth_t* synth) {
+	// the next tier waits until the running crossfade is done, so no tier is ever cut off
+	if (synth->reverb_fading >= 0) {
+		return;
+	}
+	int32_t slots = gs_atomic_load(&synth->reverb_slots);
+	while (slots >> GS_REVERB_PENDING_SHIFT) {
+		const int next = (slots >> GS_REVERB_PENDING_SHIFT) - 1;
+		const int32_t previous = gs_atomic_cas(&synth->reverb_slots, slots, (1 << next) | (1 << synth->reverb_current));
+		if (previous == slots) {
+			synth->reverb_fading = synth->reverb_current;
+			synth->reverb_current = next;
+			synth->reverb_fade_frames = 2 * synth->reverb_fade_length;
+			return;
+		}
+		slots = previous;
+	}
+}
+
+static void _granular_synth_render_voice_job(void* data, int thread, int job) {
+	granular_synth_t* synth = (granular_synth_t*)data;
+	(void)thread; // every voice renders into its own buffer, whichever thread runs it
+
+	float* mix[GS_MAX_CHANNELS];
+	for (int channel = 0; channel < GS_MAX_CHANNELS; channel++) {
+		mix[channel] = synth->worker_jobs.mix[job][channel];
+		memset(mix[channel], 0, sizeof(float) * synth->worker_jobs.num_frames);
+	}
+
+	voice_render_block(
+		synth->worker_jobs.voices[job], synth->worker_jobs.voices[job]->source, mix,
+		synth->worker_jobs.num_channels, synth->worker_jobs.num_frames,
+		(float)synth->sample_rate
+	);
+}
+
+void event_queue_init(event_queue_t* queue) {
+	gs_atomic_store(&queue->head, 0);
+	gs_atomic_store(&queue->tail, 0);
+}
+
+int event_queue_push(event_queue_t* queue, const synth_event_t* event) {
+	const uint32_t tail = (uint32_t)gs_atomic_load(&queue->tail);
+	if (tail - (uint32_t)gs_atomic_load(&queue->head) >= GS_EVENT_QUEUE_SIZE) {
+		return 0;
+	}
+
+	queue->events[tail & (GS_EVENT_QUEUE_SIZE - 1)] = *event;
+	gs_atomic_store(&queue->tail, (int32_t)(tail + 1));
+	return 1;
+}
+
+// frame the event plays at, INT64_MAX while it belongs to a later callback
+static int64_t _granular_synth_event_frame(granular_synth_t* synth, const synth_event_t* event) {
+	if (event->time <= 0.0 || synth->clock.time <= 0.0) {
+		return 0; // untimed, or nobody sets the clock
+	}
+	if (event->time >= synth->clock.time) {
+		return INT64_MAX;
+	}
+	if (synth->clock.previous_time <= 0.0) {
+		return synth->clock.frame; // first callback
+	}
+
+	const double delay = (event->time - synth->clock.previous_time) * synth->sample_rate;
+	return synth->clock.frame + (delay > 0.0 ? (int64_t)delay : 0);
+}
+
+static void _granular_synth_apply_event(granular_synth_t* synth, const synth_event_t* event) {
+	switch (event->type) {
+		case GS_EVENT_NOTE_ON: granular_synth_noteon(synth, event->id, event->pitch, event->velocity); break;
+		case GS_EVENT_NOTE_OFF: granular_synth_noteoff(synth, event->id); break;
+		case GS_EVENT_CONTROL: granular_synth_control(synth, event->id, event->velocity); break;
+		default: break;
+	}
+}
+
+// applies the queued events due at or before frame, returns the frame of the next one (INT64_MAX when there is none)
+static int64_t _granular_synth_apply_events(granular_synth_t* synth, int64_t frame) {
+	event_queue_t* queue = &synth->events;
+	const uint32_t tail = (uint32_t)gs_atomic_load(&queue->tail);
+	uint32_t head = (uint32_t)gs_atomic_load(&queue->head);
+
+	int64_t next_frame = INT64_MAX;
+	while (head != tail) {
+		const synth_event_t* event = &queue->events[head & (GS_EVENT_QUEUE_SIZE - 1)];
+		const int64_t event_frame = _granular_synth_event_frame(synth, event);
+		if (event_frame > frame) {
+			next_frame = event_frame;
+			break;
+		}
+
+		_granular_synth_apply_event(synth, event);
+		head++;
+	}
+
+	gs_atomic_store(&queue->head, (int32_t)head);
+	return next_frame;
+}
+
+void granular_synth_set_clock(granular_synth_t* synth, double time) {
+	synth->clock.previous_time = synth->clock.time;
+	synth->clock.time = time;
+	synth->clock.frame = synth->frame_count;
+}
+
+int granular_synth_push_event(granular_synth_t* synth, const synth_event_t* event) {
+	return event_queue_push(&synth->events, event);
+}
+
+static void _granular_synth_publish_telemetry(granular_synth_t* synth) {
+	synth_telemetry_t* telemetry = &synth->telemetry;
+	synth_snapshot_t* snapshot = &telemetry->buffers[telemetry->back];
+
+	snapshot->sequence = ++telemetry->sequence;
+	snapshot->num_active_voices = 0;
+	snapshot->num_grains = 0;
+	snapshot->dropped_grains = 0;
+	snapshot->dropped_notes = synth->dropped_notes;
+
+	for (int i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
 		voice_t* voice = &synth->voices[i];
-		voice_advance(voice, (float)synth->sample.buffer.sample_rate);
+		telemetry_voice_t* info = &snapshot->voices[i];
+
+		info->active = !voice_is_free(voice);
+		info->id = voice->id;
+		info->pitch = voice->note_settings.pitch;
+		info->amplitude_envelope = voice->amplitude_envelope.value;
+		info->filter_envelope = voice->lowpass_filter_envelope.value;
+		info->fade_gain = voice->fade_gain;
+		info->num_grains = 0;
+		if (!info->active) continue;
+
+		snapshot->num_active_voices++;
+		const float voice_gain = info->amplitude_envelope * info->fade_gain;
+
+		for (int c = 0; c < voice->num_grain_chunks; c++) {
+			grain_pool_t* pool = voice->grains[c];
+			uint32_t mask = pool->active_mask;
+			while (mask) {
+				const int slot = gs_bsf32(mask);
+				mask &= mask - 1;
+
+				info->num_grains++;
+				if (snapshot->num_grains == GS_TELEMETRY_MAX_GRAINS) {
+					snapshot->dropped_grains++;
+					continue;
+				}
+
+				telemetry_grain_t* grain = &snapshot->grains[snapshot->num_grains++];
+				grain->voice = i;
+				grain->frame = (int32_t)GS_POSITION_FRAME(pool->position[slot]);
+				grain->phase = pool->phase[slot];
+				grain->gain = pool->gain[slot] * voice_gain;
+			}
+		}
 	}
+
+	telemetry->back = gs_atomic_exchange(&telemetry->middle, telemetry->back | GS_TELEMETRY_FRESH) & ~GS_TELEMETRY_FRESH;
 }
 
-voice_t* granular_synth_get_free_voice(granular_synth_t* synth) {
+const synth_snapshot_t* granular_synth_read_telemetry(granular_synth_t* synth) {
+	synth_telemetry_t* telemetry = &synth->telemetry;
+	if (gs_atomic_load(&telemetry->middle) & GS_TELEMETRY_FRESH) {
+		telemetry->front = gs_atomic_exchange(&telemetry->middle, telemetry->front) & ~GS_TELEMETRY_FRESH;
+	}
+	return &telemetry->buffers[telemetry->front];
+}
+
+static void _grain_reach(double position, double size, double size_random, float position_random, double* start, double* end) {
+	const double longest = size + fabs(size_random);
+	const double offset = fabsf(position_random) * longest;
+	if (position - offset < *start) *start = position - offset;
+	if (position + offset + longest > *end) *end = position + offset + longest;
+}
+
+// a prefetched sample keeps resident what grains can reach: the window with its randomization,
+// and the windows the playing voices started with. voices still on a replaced sample are left to what it has resident
+static void _granular_synth_update_prefetch_region(granular_synth_t* synth) {
+	if (!synth->sample.source->stream.running) {
+		return;
+	}
+
+	double start = DBL_MAX, end = -DBL_MAX;
+	_grain_reach(
+		synth->sample.window_start, synth->sample.window_end - synth->sample.window_start,
+		synth->random_settings.size_random, synth->random_settings.position_offset_random, &start, &end
+	);
 	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
 		voice_t* voice = &synth->voices[i];
-		if (voice_is_free(voice)) {
-			return voice;
+		if (voice_is_free(voice) || voice->source != synth->sample.source) continue;
+		_grain_reach(
+			voice->grain_settings.position, voice->grain_settings.size,
+			voice->random_settings.size_random, voice->random_settings.position_offset_random, &start, &end
+		);
+	}
+	sample_source_set_region(synth->sample.source, start, end);
+}
+
+void granular_synth_prefetch_sample(granular_synth_t* synth) {
+	_granular_synth_update_prefetch_region(synth);
+	sample_source_wait_region(synth->sample.source);
+}
+
+// a paged sample only evicts between blocks, while no voice reads from it. that includes replaced
+// samples voices still play on
+static void _granular_synth_collect_samples(granular_synth_t* synth) {
+	sample_source_collect(synth->sample.source);
+	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+		sample_source_t* source = synth->voices[i].source;
+		if (voice_is_free(&synth->voices[i]) || source == synth->sample.source) continue;
+
+		size_t seen = 0;
+		while (seen < i && (voice_is_free(&synth->voices[seen]) || synth->voices[seen].source != source)) {
+			seen++;
+		}
+		if (seen == i) {
+			sample_source_collect(source);
 		}
 	}
-	return NULL;
 }
 
-void granular_synth_noteon(granular_synth_t* synth, uint32_t id, float pitch, float velocity) {
+void granular_synth_render_block(granular_synth_t* synth, float** out, int num_channels, int num_frames) {
+	// picking up a swapped in sample is a few atomic loads and stores, notes started from here on play on it
+	_granular_synth_acquire_sample(synth);
+	const float sample_rate = (float)synth->sample_rate;
+	const int render_channels = num_channels < GS_MAX_CHANNELS ? num_channels : GS_MAX_CHANNELS;
+
+	float mix_buffer[GS_MAX_CHANNELS][GS_BLOCK_SIZE];
+	float* mix[GS_MAX_CHANNELS];
+	sf_sample_st reverb_in[GS_BLOCK_SIZE], reverb_out[GS_BLOCK_SIZE], reverb_fade[GS_BLOCK_SIZE];
+	for (int channel = 0; channel < GS_MAX_CHANNELS; channel++) {
+		mix[channel] = mix_buffer[channel];
+	}
+
+	// a tier built by granular_synth_set_reverb_quality is a few atomics to pick up, the build happened there
+	_granular_synth_acquire_reverb(synth);
+
+	_granular_synth_update_prefetch_region(synth);
+
+	int offset = 0;
+	while (offset < num_frames) {
+		// the block ends early where the next event is due
+		const int64_t next_event = _granular_synth_apply_events(synth, synth->frame_count);
+		int frames = num_frames - offset < GS_BLOCK_SIZE ? num_frames - offset : GS_BLOCK_SIZE;
+		if (next_event - synth->frame_count < frames) {
+			frames = (int)(next_event - synth->frame_count);
+		}
+
+		_granular_synth_collect_samples(synth);
+
+		// stolen voices that finished fading out start their new note
+		for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+			voice_t* voice = &synth->voices[i];
+			if (voice->pending_note.active && voice_is_free(voice)) {
+				const uint32_t id = voice->pending_note.id;
+				const int sustained = voice->sustained;
+				_granular_synth_start_voice(synth, voice, id, voice->pending_note.pitch, voice->pending_note.velocity);
+				voice->sustained = sustained;
+			}
+		}
+
+		// the block also ends early where a stolen voice finishes fading out, its note starts right after
+		for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+			voice_t* voice = &synth->voices[i];
+			if (voice->pending_note.active && !voice_is_free(voice) && voice->fade_frames < frames) {
+				frames = voice->fade_frames;
+			}
+		}
+
+		for (int channel = 0; channel < render_channels; channel++) {
+			memset(mix[channel], 0, sizeof(float) * frames);
+		}
+
+		// free voices are silent and get reset on note on, so they are not advanced
+		int num_active = 0;
+		for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+			voice_t* voice = &synth->voices[i];
+			if (voice_is_free(voice)) continue;
+			synth->worker_jobs.voices[num_active++] = voice;
+		}
+
+		if (synth->workers.num_workers > 0 && num_active > 1) {
+			synth->worker_jobs.num_channels = render_channels;
+			synth->worker_jobs.num_frames = frames;
+			worker_pool_run(&synth->workers, _granular_synth_render_voice_job, synth, num_active);
+
+			// same order and rounding as the serial path below
+			for (int i = 0; i < num_active; i++) {
+				for (int channel = 0; channel < render_channels; channel++) {
+					const float* src = synth->worker_jobs.mix[i][channel];
+					for (int frame = 0; frame < frames; frame++) {
+						mix[channel][frame] += src[frame];
+					}
+				}
+			}
+		} else {
+			for (int i = 0; i < num_active; i++) {
+				voice_t* voice = synth->worker_jobs.voices[i];
+				voice_render_block(voice, voice->source, mix, render_channels, frames, sample_rate);
+			}
+		}
+
+		// master bus: one pass of the stereo reverb over the whole block
+		const float* left = mix[0];
+		const float* right = render_channels > 1 ? mix[1] : mix[0];
+		for (int frame = 0; frame < frames; frame++) {
+			reverb_in[frame].L = left[frame];
+			reverb_in[frame].R = right[frame];
+		}
+
+		if (synth->reverb_fading < 0) {
+			sf_reverb_process(&synth->reverbs[synth->reverb_current], frames, reverb_in, reverb_out);
+		} else {
+			// the new tier starts from empty delay lines, so its input is ramped in first while only the old
+			// tier is heard (a hard start rings through the early reflections), then the outputs crossfade
+			const int fade_length = synth->reverb_fade_length;
+			const float fade_step = 1.0f / (float)fade_length;
+			for (int frame = 0; frame < frames; frame++) {
+				const int remaining = synth->reverb_fade_frames - frame;
+				const float gain = remaining > fade_length ? (float)(2 * fade_length - remaining) * fade_step : 1.0f;
+				reverb_fade[frame].L = reverb_in[frame].L * gain;
+				reverb_fade[frame].R = reverb_in[frame].R * gain;
+			}
+			sf_reverb_process(&synth->reverbs[synth->reverb_current], frames, reverb_fade, reverb_out);
+			sf_reverb_process(&synth->reverbs[synth->reverb_fading], frames, reverb_in, reverb_fade);
+			for (int frame = 0; frame < frames; frame++) {
+				const int remaining = synth->reverb_fade_frames - frame;
+				const float gain = remaining > fade_length ? 1.0f : remaining > 0 ? (float)remaining * fade_step : 0.0f;
+				reverb_out[frame].L += (reverb_fade[frame].L - reverb_out[frame].L) * gain;
+				reverb_out[frame].R += (reverb_fade[frame].R - reverb_out[frame].R) * gain;
+			}
+			synth->reverb_fade_frames -= frames;
+			if (synth->reverb_fade_frames <= 0) {
+				// only the audio thread touches the busy bits, so this clears exactly the faded state
+				gs_atomic_add(&synth->reverb_slots, -(1 << synth->reverb_fading));
+				synth->reverb_fading = -1;
+			}
+		}
+
+		for (int frame = 0; frame < frames; frame++) {
+			out[0][offset + frame] = reverb_out[frame].L;
+		}
+		if (render_channels > 1) {
+			for (int frame = 0; frame < frames; frame++) {
+				out[1][offset + frame] = reverb_out[frame].R;
+			}
+		}
+
+		for (int channel = render_channels; channel < num_channels; channel++) {
+			memset(out[channel] + offset, 0, sizeof(float) * frames);
+		}
+
+		offset += frames;
+		synth->frame_count += frames;
+	}
+
+	_granular_synth_publish_telemetry(synth);
+}
+
+void granular_synth_set_window_curve(granular_synth_t* synth, curve_t* curve) {
+	window_table_bake_curve(&synth->window_tables[GRAIN_WINDOW_CURVE], curve);
+}
+
+voice_t* granular_synth_get_free_voice(granular_synth_t* synth) {
+	voice_allocator_t* allocator = &synth->voice_allocator;
+	if (allocator->num_free == 0) {
+		_granular_synth_reclaim_voices(synth);
+		if (allocator->num_free == 0) {
+			return NULL;
+		}
+	}
+
+	const int index = allocator->free_voices[--allocator->num_free];
+	voice_allocator_push_newest(allocator, index);
+	return &synth->voices[index];
+}
+
+int granular_synth_noteon(granular_synth_t* synth, uint32_t id, float pitch, float velocity) {
+	voice_allocator_t* allocator = &synth->voice_allocator;
+
+	const int playing = voice_allocator_find(allocator, id);
+	if (playing >= 0) {
+		voice_t* voice = &synth->voices[playing];
+		if (allocator->steal_policy == GS_STEAL_SAME_NOTE && (!voice_is_free(voice) || voice->pending_note.active)) {
+			_granular_synth_steal_voice(synth, playing, id, pitch, velocity);
+			return 1;
+		}
+
+		// the note already playing on this id is released, note off only reaches the new voice
+		voice_allocator_unmap(allocator, playing);
+		if (voice->pending_note.active) {
+			voice->pending_note.active = 0;
+		} else if (!voice_is_free(voice)) {
+			voice_gate(voice, 0);
+		}
+	}
+
 	voice_t* voice = granular_synth_get_free_voice(synth);
-	if (voice == NULL) {
-		return;
+	if (voice != NULL) {
+		_granular_synth_start_voice(synth, voice, id, pitch, velocity);
+		voice_allocator_map(allocator, (int)(voice - synth->voices), id);
+		return 1;
 	}
 
-	voice_init(voice, synth->sample.buffer.sample_rate);
-	voice->id = id;
-	voice->note_settings.pitch = pitch + synth->tuning;
-	voice->note_settings.velocity = velocity;
-	voice->grain_settings.position = synth->sample.window_start;
-	voice->grain_settings.size = synth->sample.window_end - synth->sample.window_start;
-	voice->grain_settings.grains_per_second = synth->grain_settings.grains_per_second;
-	voice->grain_settings.smoothness = synth->grain_settings.grain_smoothness;
-	voice->grain_settings.play_mode = synth->grain_settings.play_mode;
-	voice->grain_spawn_timer = voice->grain_settings.grains_per_second;
-	voice->random_settings.size_random = synth->random_settings.size_random;
-	voice->random_settings.position_offset_random = synth->random_settings.position_offset_random;
-	
-	voice_gate(voice, 1);
+	const int victim = _granular_synth_pick_victim(synth);
+	if (victim < 0) {
+		synth->dropped_notes++;
+		return 0;
+	}
+	_granular_synth_steal_voice(synth, victim, id, pitch, velocity);
+	return 1;
 }
 
 void granular_synth_noteoff(granular_synth_t* synth, uint32_t id) {
-	for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
-		voice_t* voice = &synth->voices[i];
-		if (voice->id == id) {
-			voice_gate(voice, 0);
+	voice_allocator_t* allocator = &synth->voice_allocator;
+
+	const int index = voice_allocator_find(allocator, id);
+	if (index < 0) {
+		return;
+	}
+	voice_allocator_unmap(allocator, index);
+
+	voice_t* voice = &synth->voices[index];
+	if (synth->sustain) {
+		// released when the pedal comes up
+		voice->sustained = 1;
+		return;
+	}
+
+	if (voice->pending_note.active) {
+		// released before it got to play, the stolen voice just fades out
+		voice->pending_note.active = 0;
+	} else if (!voice_is_free(voice)) {
+		voice_gate(voice, 0);
+	}
+}
+
+void granular_synth_control(granular_synth_t* synth, uint32_t controller, float value) {
+	if (controller != GS_CONTROL_SUSTAIN) {
+		return;
+	}
+
+	const int sustain = value >= 0.5f;
+	if (synth->sustain && !sustain) {
+		for (size_t i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
+			voice_t* voice = &synth->voices[i];
+			if (!voice->sustained) continue;
+
+			voice->sustained = 0;
+			if (voice->pending_note.active) {
+				voice->pending_note.active = 0;
+			} else if (!voice_is_free(voice)) {
+				voice_gate(voice, 0);
+			}
 		}
 	}
+	synth->sustain = sustain;
 }
 
 int granular_synth_active_voice_count(granular_synth_t* synth) {
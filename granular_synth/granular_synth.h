@@ -6,14 +6,29 @@
 #include "smol_audio.h"
 
 #include "sndfilter/reverb.h"
+#include "worker_pool.h"
+#include "rng.h"
+#include "sample_source.h"
+#include "sample_manager.h"
 
 #define GS_ENVELOPE_MAX_POINTS 64
 #define GS_ENVELOPE_MAX_SLOPES (GS_ENVELOPE_MAX_POINTS / 2)
 
-#define GS_VOICE_MAX_GRAINS 32
+#define GS_GRAIN_CHUNK_SIZE 32 // grain slots per grain_pool_t, voices borrow whole chunks
+#define GS_VOICE_MAX_CHUNKS 16 // most chunks a single voice may hold
+#define GS_DEFAULT_MAX_GRAINS 256 // grains shared by all voices unless granular_synth_set_max_grains says otherwise
 #define GS_SYNTH_MAX_VOICES 8
+#define GS_VOICE_MAP_SIZE 16 // note id hash buckets, power of two
+#define GS_STEAL_FADE_TIME 0.005f // fade out of a stolen voice in seconds
+#define GS_REVERB_STATES 3 // the playing reverb tier, the one fading out and a spare to build the next in
+#define GS_REVERB_FADE_TIME 0.05f // a new reverb tier warms up for this long in seconds, then crossfades for as long
+#define GS_REVERB_PENDING_SHIFT 4 // reverb_slots keeps the busy state bits below this and the pending state + 1 above
+#define GS_DEFAULT_SEED 1
 #define GS_FILTER_MAX_STAGES 4
 
+#define GS_MAX_CHANNELS 2
+#define GS_BLOCK_SIZE 256 // frames processed per inner block
+
 typedef struct curve_point_t {
 	float value, slope;
 	double time;
@@ -32,6 +47,29 @@ void curve_add_point(curve_t* curve, float value, double time, float slope);
 void curve_set_point(curve_t* curve, size_t index, float value, double time, float slope);
 void curve_free(curve_t* curve);
 
+#define GS_WINDOW_TABLE_SIZE 512 // segments per window ramp
+
+typedef enum grain_window_shape {
+	GRAIN_WINDOW_SIGMOID = 0, // smoothness sigmoid, decays to 0.01
+	GRAIN_WINDOW_HANN, // raised cosine, a tukey window when smoothness < 1
+	GRAIN_WINDOW_GAUSSIAN,
+	GRAIN_WINDOW_TRAPEZOID,
+	GRAIN_WINDOW_CURVE, // baked from a curve_t with window_table_bake_curve
+	GRAIN_WINDOW_COUNT
+} grain_window_shape;
+
+// attack and release ramps of a grain window, sampled over [0, 1] plus one guard point each
+// smoothness sets how much of the grain each ramp covers, the window holds in between
+typedef struct window_table_t {
+	float attack[GS_WINDOW_TABLE_SIZE + 2];
+	float release[GS_WINDOW_TABLE_SIZE + 2];
+} window_table_t;
+
+void window_table_bake(window_table_t* table, grain_window_shape shape);
+// the first half of the curve becomes the attack and the second half the release
+void window_table_bake_curve(window_table_t* table, curve_t* curve);
+const window_table_t* window_table_default(void);
+
 typedef struct adsr_t {
 	float attack;
 	float decay;
@@ -54,41 +92,80 @@ void adsr_init(adsr_t* adsr);
 void adsr_gate(adsr_t* adsr, int gate);
 void adsr_update(adsr_t* adsr, float sample_rate);
 
-typedef struct grain_t {
-	double size; // grain size in seconds
-	double position; // position in seconds
-
-	float pitch; // pitch factor, 1.0 = original pitch
-	float velocity; // velocity factor (note velocity), 1.0 = original velocity
-
-	double time;
-
-	float computed_amplitude;
-	float computed_pitch;
-	double computed_time;
-
-	float smoothness;
-
-	enum {
-		GRAIN_FORWARD = 0,
-		GRAIN_REVERSE,
-		GRAIN_PINGPONG
-	} play_mode;
-
-	enum {
-		GRAIN_IDLE = 0,
-		GRAIN_PLAYING,
-		GRAIN_FINISHED
-	} state;
-} grain_t;
-
-void grain_init(grain_t* grain);
-void grain_update(grain_t* grain, float sample_rate);
-int grain_is_free(grain_t* grain);
-
-float grain_get_time_factor(grain_t* grain, float ntime);
-int grain_check_grain_end(grain_t* grain, float ntime);
-void grain_render_channel(grain_t* grain, smol_audiobuffer_t* buffer, int channel, float* out);
+typedef enum grain_play_mode {
+	GRAIN_FORWARD = 0,
+	GRAIN_REVERSE,
+	GRAIN_PINGPONG
+} grain_play_mode;
+
+// grain read positions are 32.32 fixed point source frames
+#define GS_POSITION_FRAC_BITS 32
+#define GS_POSITION_ONE ((int64_t)1 << GS_POSITION_FRAC_BITS)
+#define GS_POSITION_FRAME(position) ((position) >> GS_POSITION_FRAC_BITS) // floor, relies on arithmetic shift
+
+#if GS_GRAIN_CHUNK_SIZE > 32
+#	error grain_pool_t tracks its slots in a 32 bit mask
+#endif
+
+// structure-of-arrays grain store, every field is indexed by grain slot
+// an idle slot has frames_left == 0 and amplitude == 0, so the kernel can run it without branching
+typedef struct grain_pool_t {
+	gs_atomic32_t in_use; // borrowed from the grain_bank_t by a voice
+	uint32_t active_mask; // bit i set = slot i is playing
+	int64_t position[GS_GRAIN_CHUNK_SIZE]; // read position in source frames, 32.32 fixed point
+	int64_t increment[GS_GRAIN_CHUNK_SIZE]; // source frames per output frame, 32.32 (negative when playing backwards)
+	int64_t turn_position[GS_GRAIN_CHUNK_SIZE]; // where ping-pong grains turn around, 32.32
+
+	float phase[GS_GRAIN_CHUNK_SIZE]; // window phase, 0 = grain start, 1 = grain end
+	float phase_increment[GS_GRAIN_CHUNK_SIZE];
+	float turn_phase[GS_GRAIN_CHUNK_SIZE]; // 1 for ping-pong grains, never reached otherwise
+
+	float amplitude[GS_GRAIN_CHUNK_SIZE]; // velocity
+	const window_table_t* window[GS_GRAIN_CHUNK_SIZE];
+	float window_width[GS_GRAIN_CHUNK_SIZE]; // attack/decay width in window phase, from smoothness
+	float window_scale[GS_GRAIN_CHUNK_SIZE]; // 1 / window_width
+
+	float gain[GS_GRAIN_CHUNK_SIZE]; // last computed amplitude * window, for display
+
+	int32_t frames_left[GS_GRAIN_CHUNK_SIZE]; // output frames until the grain ends
+} grain_pool_t;
+
+void grain_pool_init(grain_pool_t* pool);
+// stops every grain in the pool
+void grain_pool_clear(grain_pool_t* pool);
+
+// starts a grain in a free slot, returns the slot or -1 when the pool is full (or source_rate is 0)
+// position and size are in seconds of the source, which plays at source_rate on an output running at sample_rate
+int grain_pool_spawn(
+	grain_pool_t* pool, grain_play_mode play_mode,
+	double position, double size,
+	float pitch, float velocity,
+	const window_table_t* window, float smoothness,
+	float source_rate, float sample_rate
+);
+
+int grain_pool_is_playing(grain_pool_t* pool, int index);
+int grain_pool_active_count(grain_pool_t* pool);
+
+// adds the contribution of every playing grain for the current frame to out[0..num_channels-1]
+// and advances all of them by one frame
+void grain_pool_render_frame(grain_pool_t* pool, sample_source_t* source, float* out, int num_channels);
+
+// grain chunks shared by all voices, allocated up front so the audio thread never allocates
+// voices borrow a chunk when their own ones are full and hand it back once it runs empty
+typedef struct grain_bank_t {
+	grain_pool_t* chunks;
+	int num_chunks;
+	gs_atomic32_t search_start; // where the next free chunk search begins
+} grain_bank_t;
+
+// max_grains is rounded up to whole chunks, returns 0 when the allocation fails
+int grain_bank_init(grain_bank_t* bank, int max_grains);
+void grain_bank_free(grain_bank_t* bank);
+// lock free, returns NULL when every chunk is borrowed
+grain_pool_t* grain_bank_acquire(grain_bank_t* bank);
+// clears the chunk and hands it back to the bank it was borrowed from
+void grain_bank_release(grain_pool_t* chunk);
 
 typedef struct filter_t filter_t;
 
@@ -123,13 +200,20 @@ typedef enum granular_synth_play_mode {
 typedef struct voice_t {
 	uint32_t id;
 
-	grain_t grains[GS_VOICE_MAX_GRAINS];
+	// the sample the note started on, it plays on it to the end when another one is swapped in
+	sample_source_t* source;
+	int32_t sample_epoch;
+
+	grain_bank_t* grain_bank;
+	grain_pool_t* grains[GS_VOICE_MAX_CHUNKS]; // borrowed chunks
+	int num_grain_chunks;
 	adsr_t amplitude_envelope;
 
 	struct {
 		int grains_per_second; // grains per second, min 1
 		double size; // grain size in seconds
 		float smoothness;
+		const window_table_t* window;
 		double position; // grain position in seconds
 		granular_synth_play_mode play_mode;
 	} grain_settings;
@@ -145,6 +229,7 @@ typedef struct voice_t {
 	} random_settings;
 
 	double grain_spawn_timer;
+	gs_rng_t rng; // grain randomization, seeded by the synth on every note
 
 	enum {
 		VOICE_IDLE = 0,
@@ -154,31 +239,151 @@ typedef struct voice_t {
 	filter_lowpass_params_t lowpass_filter_params;
 	filter_t lowpass_filter[2];
 	adsr_t lowpass_filter_envelope;
+
+	float fade_gain; // 1 unless the voice is being stolen
+	float fade_step;
+	int fade_frames; // frames left until the fade out ends, 0 when not fading
+
+	int sustained; // note off arrived while the sustain pedal was down
+
+	// note that takes the voice over once it faded out
+	struct {
+		int active;
+		uint32_t id;
+		float pitch, velocity;
+	} pending_note;
 } voice_t;
 
 void voice_init(voice_t* voice, int sample_rate);
-grain_t* voice_get_free_grain(voice_t* voice);
-void voice_spawn_grain(voice_t* voice);
+// sample_rate is the output rate, grains are placed at the rate of source
+void voice_spawn_grain(voice_t* voice, const sample_source_t* source, float sample_rate);
+// stops the voice's grains and hands its chunks back to the bank
+void voice_release_grains(voice_t* voice);
 int voice_is_free(voice_t* voice);
 void voice_gate(voice_t* voice, int gate);
-
-void voice_render_channel(voice_t* voice, smol_audiobuffer_t* buffer, int channel, float* out);
-void voice_advance(voice_t* voice, float sample_rate);
+// fades the voice out over GS_STEAL_FADE_TIME (rounded to whole frames), it goes idle afterwards
+void voice_fade_out(voice_t* voice, float sample_rate);
+
+// writes the voice's output for the current frame to out[0..num_channels-1] (num_channels <= GS_MAX_CHANNELS)
+// and advances its grains, voice_advance handles spawning and the envelopes
+void voice_render_frame(voice_t* voice, sample_source_t* source, float* out, int num_channels);
+void voice_advance(voice_t* voice, const sample_source_t* source, float sample_rate);
+
+// renders num_frames frames of the voice and adds them to out (planar, one pointer per channel)
+void voice_render_block(voice_t* voice, sample_source_t* source, float** out, int num_channels, int num_frames, float sample_rate);
+
+typedef enum voice_steal_policy {
+	GS_STEAL_NONE = 0, // drop new notes while every voice is busy
+	GS_STEAL_OLDEST,
+	GS_STEAL_QUIETEST,
+	GS_STEAL_SAME_NOTE // retrigger the voice already playing the note, otherwise steal the oldest
+} voice_steal_policy;
+
+// voice bookkeeping by index: a free list, the playing voices from oldest to newest
+// and a note id -> voice hash chained through map_next
+typedef struct voice_allocator_t {
+	int free_voices[GS_SYNTH_MAX_VOICES];
+	int num_free;
+
+	int oldest, newest; // -1 when no voice is playing
+	int prev[GS_SYNTH_MAX_VOICES], next[GS_SYNTH_MAX_VOICES];
+
+	int map_head[GS_VOICE_MAP_SIZE];
+	int map_next[GS_SYNTH_MAX_VOICES];
+	uint32_t map_key[GS_SYNTH_MAX_VOICES];
+	int mapped[GS_SYNTH_MAX_VOICES];
+
+	voice_steal_policy steal_policy;
+} voice_allocator_t;
+
+#define GS_EVENT_QUEUE_SIZE 256 // power of two
+#define GS_CONTROL_SUSTAIN 64
+
+typedef enum synth_event_type {
+	GS_EVENT_NOTE_ON = 0,
+	GS_EVENT_NOTE_OFF,
+	GS_EVENT_CONTROL
+} synth_event_type;
+
+typedef struct synth_event_t {
+	synth_event_type type;
+	uint32_t id; // note id, or the controller for GS_EVENT_CONTROL
+	float pitch;
+	float velocity; // or the controller value, 0..1
+	double time; // gs_timer() when the event happened, 0 plays it at the start of the next block
+} synth_event_t;
+
+// single producer, single consumer ring of events, the producer only writes tail and the audio thread only head
+typedef struct event_queue_t {
+	synth_event_t events[GS_EVENT_QUEUE_SIZE];
+	gs_atomic32_t head; // next event to read
+	gs_atomic32_t tail; // next free slot
+} event_queue_t;
+
+void event_queue_init(event_queue_t* queue);
+// returns 0 when the queue is full
+int event_queue_push(event_queue_t* queue, const synth_event_t* event);
+
+#define GS_TELEMETRY_MAX_GRAINS 512
+#define GS_TELEMETRY_FRESH 4 // set in synth_telemetry_t.middle while the reader has not taken it
+
+// what the GUI gets to see of the synth, published by the audio thread after every render_block call
+typedef struct telemetry_grain_t {
+	int voice; // index into granular_synth_t.voices
+	int32_t frame; // read position in source frames
+	float phase; // window phase
+	float gain; // window * velocity * voice envelope and fade
+} telemetry_grain_t;
+
+typedef struct telemetry_voice_t {
+	int active;
+	uint32_t id;
+	float pitch;
+	float amplitude_envelope, filter_envelope, fade_gain;
+	int num_grains;
+} telemetry_voice_t;
+
+typedef struct synth_snapshot_t {
+	uint32_t sequence; // render_block calls so far
+	int num_active_voices;
+	telemetry_voice_t voices[GS_SYNTH_MAX_VOICES];
+	int num_grains;
+	int dropped_grains; // playing grains that did not fit
+	uint32_t dropped_notes; // note ons that found no voice to play on, since init
+	telemetry_grain_t grains[GS_TELEMETRY_MAX_GRAINS];
+} synth_snapshot_t;
+
+// triple buffer: the audio thread fills back and swaps it with middle, the reader swaps middle with front
+// when it is fresh. neither side waits and each only ever touches its own buffer
+typedef struct synth_telemetry_t {
+	synth_snapshot_t buffers[3];
+	gs_atomic32_t middle; // buffer index | GS_TELEMETRY_FRESH
+	int back; // audio thread only
+	int front; // reader only
+	uint32_t sequence;
+} synth_telemetry_t;
 
 typedef struct granular_synth_t {
 	voice_t voices[GS_SYNTH_MAX_VOICES];
+	voice_allocator_t voice_allocator;
+	grain_bank_t grain_bank;
 
 	struct {
-		smol_audiobuffer_t buffer;
+		sample_manager_t manager;
+		sample_source_t* source; // picked up from the manager by render_block, new notes start on it
+		int32_t epoch; // manager epoch source was picked up in
 		double window_start, window_end; // window start and end in seconds
 	} sample;
 
 	struct {
 		int grains_per_second; // grains per second, min 1
 		float grain_smoothness;
+		grain_window_shape window_shape;
 		granular_synth_play_mode play_mode;
 	} grain_settings;
 
+	window_table_t window_tables[GRAIN_WINDOW_COUNT];
+
 	struct {
 		double size_random; // random size to add in seconds
 		float position_offset_random; // random offset in % of grain size
@@ -186,20 +391,104 @@ typedef struct granular_synth_t {
 
 	float tuning;
 
-	sf_reverb_state_st reverb_filter;
-} granular_synth_t;
+	// granular_synth_set_reverb_quality builds a tier in a state render_block is not playing,
+	// render_block picks it up at its next block and crossfades from the old one
+	sf_reverb_state_st reverbs[GS_REVERB_STATES];
+	gs_atomic32_t reverb_slots; // states render_block plays as bits, the state waiting to be picked up + 1 shifted up
+	int reverb_current, reverb_fading; // audio thread only, reverb_fading is -1 when no tier fades out
+	int reverb_fade_frames, reverb_fade_length;
+	sf_reverb_quality reverb_quality; // last tier asked for, only touched by granular_synth_set_reverb_quality
+
+	// optional voice rendering threads, every voice renders into its own scratch buffer
+	// and they are summed in voice order, so the mix does not depend on which thread rendered what
+	worker_pool_t workers;
+	struct {
+		voice_t* voices[GS_SYNTH_MAX_VOICES];
+		int num_channels, num_frames;
+		float mix[GS_SYNTH_MAX_VOICES][GS_MAX_CHANNELS][GS_BLOCK_SIZE];
+	} worker_jobs;
+
+	synth_telemetry_t telemetry;
+
+	// events from other threads, applied by render_block at the frame they happened one buffer later
+	event_queue_t events;
+	struct {
+		double time, previous_time; // gs_timer() at the start of this and the previous audio callback
+		int64_t frame; // frame_count at the start of this callback
+	} clock;
+	int64_t frame_count; // frames rendered so far
+	int sample_rate; // output rate given to granular_synth_init
 
-void granular_synth_init(granular_synth_t* synth, int sample_rate, const char* sample_file);
-void granular_synth_render_channel(granular_synth_t* synth, int channel, float* out);
-void granular_synth_advance(granular_synth_t* synth);
+	int sustain; // sustain pedal down
+	uint32_t dropped_notes; // note ons that found no voice to play on
 
+	gs_rng_t rng; // seeds the voices, advanced once per note on the audio thread
+} granular_synth_t;
+
+// loads sample_file with SAMPLE_LOAD_RESIDENT, so the render threads never read from disk. mapped and streamed
+// samples are opt-in through granular_synth_load_sample. the synth renders at sample_rate whatever rate the sample has
+// returns 0 when the grain bank or the reverb could not be allocated (a sample that fails to load only leaves it silent),
+// call granular_synth_free either way
+int granular_synth_init(granular_synth_t* synth, int sample_rate, const char* sample_file);
+// replaces the sample and resets the window to all of it, returns 1 on success (the old sample stays otherwise)
+// waits for the load and switches the audio thread over, call it while the audio device is paused
+int granular_synth_load_sample(granular_synth_t* synth, const char* sample_file, sample_load_mode mode);
+// safe from any thread but the audio thread, which never waits for it: the file is opened on the loader
+// thread and swapped in between two blocks. notes playing then finish on the old sample, the window is kept.
+// returns the request id for granular_synth_sample_status, 0 when it could not be queued
+int32_t granular_synth_load_sample_async(granular_synth_t* synth, const char* sample_file, sample_load_mode mode);
+// 0 while the load is pending, 1 once the sample was swapped in, -1 when it failed or a newer load replaced it
+int granular_synth_sample_status(granular_synth_t* synth, int32_t id);
+// offline rendering: waits until a streamed or qoa sample has what grains can reach in the next block resident,
+// so it renders without misses. does nothing for other samples, never call it from the audio thread
+void granular_synth_prefetch_sample(granular_synth_t* synth);
+// restarts the random streams, renders of the same events with the same seed are bit-identical
+void granular_synth_set_seed(granular_synth_t* synth, uint64_t seed);
+// resizes the shared grain bank, stops every voice
+// allocates, so call it while the audio device is paused
+int granular_synth_set_max_grains(granular_synth_t* synth, int max_grains);
+
+// starts num_workers threads that render voices alongside the audio thread (0 renders everything on the audio thread)
+// returns the number of threads started
+int granular_synth_start_workers(granular_synth_t* synth, int num_workers);
+void granular_synth_stop_workers(granular_synth_t* synth);
+// stops the workers and the loader and releases the samples, the grain bank and the reverb delay lines
+void granular_synth_free(granular_synth_t* synth);
+// builds the tier on the calling thread (tens of microseconds, no allocation), call it from one control thread at a time
+// while audio runs; the audio thread picks it up at its next block once any earlier switch has finished fading
+void granular_synth_set_reverb_quality(granular_synth_t* synth, sf_reverb_quality quality);
+
+// renders num_frames frames into out (planar, one pointer per channel), overwriting its contents
+// queued events are applied at their frame, splitting the block where needed
+void granular_synth_render_block(granular_synth_t* synth, float** out, int num_channels, int num_frames);
+
+// call at the start of every audio callback with gs_timer(), before rendering it
+// an event stamped during the previous callback plays at the same offset into this one,
+// events stamped after this call wait for the next callback
+void granular_synth_set_clock(granular_synth_t* synth, double time);
+
+// safe from one other thread (the MIDI input) while the audio thread renders, returns 0 when the queue is full
+int granular_synth_push_event(granular_synth_t* synth, const synth_event_t* event);
+
+// bakes the curve into the GRAIN_WINDOW_CURVE table
+void granular_synth_set_window_curve(granular_synth_t* synth, curve_t* curve);
+
+// takes a voice off the free list and marks it as the newest playing voice, NULL when none is free
 voice_t* granular_synth_get_free_voice(granular_synth_t* synth);
 
-void granular_synth_noteon(granular_synth_t* synth, uint32_t id, float pitch, float velocity);
+// the calls below change voice state: make them from the audio thread, or while it is not rendering
+// returns 0 when the note was dropped: every voice is busy and the steal policy is GS_STEAL_NONE,
+// or every voice already waits for a stolen note to start
+int granular_synth_noteon(granular_synth_t* synth, uint32_t id, float pitch, float velocity);
 void granular_synth_noteoff(granular_synth_t* synth, uint32_t id);
+// value is 0..1, only GS_CONTROL_SUSTAIN is handled so far
+void granular_synth_control(granular_synth_t* synth, uint32_t controller, float value);
 
 int granular_synth_active_voice_count(granular_synth_t* synth);
 
+// latest published snapshot, for a single reader thread (the GUI). it stays valid until the next call
+const synth_snapshot_t* granular_synth_read_telemetry(granular_synth_t* synth);
+
 typedef void (*granular_synth_voice_cb)(int, voice_t*, void*);
 void granular_synth_for_each_voice(granular_synth_t* synth, granular_synth_voice_cb callback, void* data);
 
@@ -20,12 +20,16 @@
 
 #include "granular_synth.h"
 #include "midi.h"
+#include "deadline_profiler.h"
 
 #include <mmeapi.h>
 
 #define SAMPLE_RATE (44100)
+#define PROFILER_LOG_INTERVAL 10.0 // seconds between profiler log lines
 
 granular_synth_t synth;
+deadline_profiler_t profiler;
+int device_sample_rate = SAMPLE_RATE;
 filter_lowpass_params_t lowpass_params;
 
 void audio_callback(
@@ -39,81 +43,71 @@ void audio_callback(
 	double inv_sample_rate,
 	void* user_data
 ) {
-	for (int sample = 0; sample < num_output_samples; sample++) {
-		for (int channel = 0; channel < num_output_channels; channel++) {
-			granular_synth_render_channel(&synth, channel, &outputs[channel][sample]);
-		}
-		granular_synth_advance(&synth, sample_rate);
-	}
+	granular_synth_render_block(&synth, outputs, num_output_channels, num_output_samples);
 }
 
 //grain_t grain_test;
 //voice_t voice_test;
 
 void SDLCALL sdl_audio_callback(void* ud, Uint8* stream, int len) {
-	float* buffer = (float*)stream;
-	int num_samples = len / (sizeof(float) * 2);
-
-	for (int sample = 0; sample < num_samples; sample++) {
-		float left, right;
-		granular_synth_render_channel(&synth, 0, &left);
-		granular_synth_render_channel(&synth, 1, &right);
-
-		granular_synth_advance(&synth);
-		
-		// [GRAIN TEST]
-		//grain_render_channel(&grain_test, &synth.sample.buffer, 0, &left);
-		//grain_render_channel(&grain_test, &synth.sample.buffer, 1, &right);
+	const double start = deadline_profiler_begin(&profiler);
+	granular_synth_set_clock(&synth, start);
 
-		//grain_update(&grain_test, synth.sample.buffer.sample_rate);
+	float* buffer = (float*)stream;
+	int num_frames = len / (sizeof(float) * 2);
+	const int callback_frames = num_frames;
 
-		// [VOICE TEST]
-		/*voice_advance(&voice_test, synth.sample.buffer.sample_rate);
+	float left[GS_BLOCK_SIZE], right[GS_BLOCK_SIZE];
+	float* channels[2] = { left, right };
 
-		voice_render_channel(&voice_test, &synth.sample.buffer, 0, &left);
-		voice_render_channel(&voice_test, &synth.sample.buffer, 1, &right);*/
+	while (num_frames > 0) {
+		int frames = num_frames < GS_BLOCK_SIZE ? num_frames : GS_BLOCK_SIZE;
+		granular_synth_render_block(&synth, channels, 2, frames);
 
-		*buffer++ = left;
-		*buffer++ = right;
+		for (int sample = 0; sample < frames; sample++) {
+			*buffer++ = left[sample];
+			*buffer++ = right[sample];
+		}
+		num_frames -= frames;
 	}
+
+	deadline_profiler_end(&profiler, start, callback_frames, device_sample_rate);
 }
 
-double pixel_pos_to_sample_pos(int pixelPos, int maxPixels, const smol_audiobuffer_t* buffer) {
+double pixel_pos_to_sample_pos(int pixelPos, int maxPixels, const sample_source_t* source) {
 	double relativePos = (double)pixelPos / (maxPixels - 1);
-	return relativePos * ((double)buffer->num_frames / buffer->sample_rate);
+	return relativePos * ((double)source->num_frames / source->sample_rate);
 }
 
-int sample_pos_to_pixel_pos(double samplePosSec, int maxPixels, const smol_audiobuffer_t* buffer) {
-	double relativePos = samplePosSec / ((double)buffer->num_frames / buffer->sample_rate);
+int sample_pos_to_pixel_pos(double samplePosSec, int maxPixels, const sample_source_t* source) {
+	double relativePos = samplePosSec / ((double)source->num_frames / source->sample_rate);
 	return (int)((double)(maxPixels - 1) * relativePos);
 }
 
 void draw_waveform(
 	smol_canvas_t* canvas, rect_t bounds,
-	const smol_audiobuffer_t* buffer, int channel
+	const sample_source_t* source, int channel
 ) {
 	const int halfH = bounds.height / 2;
 	const int midY = bounds.y + halfH;
-	smol_u32 samplesPerPixel = buffer->num_frames / bounds.width;
+	smol_u32 samplesPerPixel = (smol_u32)(source->num_frames / bounds.width);
 	
 	smol_canvas_push_color(canvas);
 
 	smol_u32 sampleNo = 0;
+	float span[1024];
 	for (int ox = 0; ox < bounds.width; ox++) {
 		float sampleAvg = 0.0f;
 		float sampleRMS = 0.0f;
-		for (int sn = 0; sn < samplesPerPixel; sn++) {
-			double time = (double)sampleNo / buffer->sample_rate;
-
-			float sample = smol_audiobuffer_sample_linear(
-				buffer,
-				channel,
-				time
-			);
-			sampleAvg += fabsf(sample);
-			sampleRMS += sample * sample;
-
-			sampleNo++;
+		for (smol_u32 sn = 0; sn < samplesPerPixel; sn += 1024) {
+			int count = samplesPerPixel - sn < 1024 ? (int)(samplesPerPixel - sn) : 1024;
+			sample_source_read_span(source, channel, sampleNo, count, span);
+			for (int i = 0; i < count; i++) {
+				sampleAvg += fabsf(span[i]);
+				sampleRMS += span[i] * span[i];
+			}
+
+			sampleNo += count;
 		}
 
 		sampleRMS = sqrtf(sampleRMS / samplesPerPixel);
@@ -134,20 +128,17 @@ void draw_waveform(
 	smol_canvas_pop_color(canvas);
 }
 
-void draw_grain(smol_canvas_t* canvas, voice_t* voice, grain_t* grain, const smol_audiobuffer_t* buffer, rect_t bounds) {
-	if (grain->state == GRAIN_IDLE || grain->state == GRAIN_FINISHED) return;
+void draw_grain(smol_canvas_t* canvas, const telemetry_grain_t* grain, const sample_source_t* source, rect_t bounds) {
+	const smol_u32 samplesPerPixel = (smol_u32)(source->num_frames / bounds.width);
 
-	const smol_u32 samplesPerPixel = buffer->num_frames / bounds.width;
-
-	int grainSamplePos = (grain->computed_time + grain->position) * buffer->sample_rate;
-	int xPosOffset = grainSamplePos / samplesPerPixel;
+	int xPosOffset = grain->frame / samplesPerPixel;
 
 	smol_canvas_push_color(canvas);
 
 	smol_canvas_set_color(canvas, SMOLC_WHITE);
 	smol_canvas_draw_line(canvas, bounds.x + xPosOffset, bounds.y, bounds.x + xPosOffset, bounds.y + bounds.height-1);
 
-	int h = bounds.height * grain->computed_amplitude * voice->amplitude_envelope.value;
+	int h = bounds.height * grain->gain;
 
 	smol_canvas_set_color(canvas, SMOLC_SKYBLUE);
 	smol_canvas_fill_rect(canvas, bounds.x + xPosOffset - 2, bounds.y + (bounds.height - h), 4, h);
@@ -155,10 +146,10 @@ void draw_grain(smol_canvas_t* canvas, voice_t* voice, grain_t* grain, const smo
 	smol_canvas_pop_color(canvas);
 }
 
-void draw_guide(smol_canvas_t* canvas, const char* text, const smol_audiobuffer_t* buffer, float samplePosSec, rect_t parentBounds) {
-	const smol_u32 samplesPerPixel = buffer->num_frames / parentBounds.width;
+void draw_guide(smol_canvas_t* canvas, const char* text, const sample_source_t* source, float samplePosSec, rect_t parentBounds) {
+	const smol_u32 samplesPerPixel = (smol_u32)(source->num_frames / parentBounds.width);
 
-	int xPosOffset = samplePosSec * buffer->sample_rate / samplesPerPixel;
+	int xPosOffset = samplePosSec * source->sample_rate / samplesPerPixel;
 
 	int w, h;
 	smol_text_size(canvas, 1, text, &w, &h);
@@ -206,56 +197,37 @@ float pitch_from_midi(int note) {
 	return powf(2.0f, (note - 69) / 12.0f);
 }
 
-int sustain = 0;
-smol_vector(uint32_t) notes = { 0, 0, 0 };
-
+// runs on the winmm thread, the synth only ever sees these as queued events
 void midi_callback(midi_message_t msg) {
+	synth_event_t event = { 0 };
+	event.time = gs_timer();
+
 	switch (msg.status) {
 		case MIDI_NOTE_ON: {
-			if (sustain) {
-				int has_note = 0;
-				for (int i = 0; i < smol_vector_count(&notes); i++) {
-					if (smol_vector_at(&notes, i) == msg.note.pitch) {
-						has_note = 1;
-						break;
-					}
-				}
-
-				if (!has_note) smol_vector_push(&notes, msg.note.pitch);
-			}
-			granular_synth_noteon(
-				&synth,
-				msg.note.pitch,
-				pitch_from_midi(msg.note.pitch),
-				(float)msg.note.velocity / 127.0f
-			);
+			// note on with velocity 0 is a note off
+			event.type = msg.note.velocity > 0 ? GS_EVENT_NOTE_ON : GS_EVENT_NOTE_OFF;
+			event.id = msg.note.pitch;
+			event.pitch = pitch_from_midi(msg.note.pitch);
+			event.velocity = (float)msg.note.velocity / 127.0f;
 		} break;
 		case MIDI_NOTE_OFF: {
-			if (!sustain) {
-				granular_synth_noteoff(&synth, msg.note.pitch);
-			}
+			event.type = GS_EVENT_NOTE_OFF;
+			event.id = msg.note.pitch;
 		} break;
 		case MIDI_CONTROL_CHANGE: {
-			if (msg.control_change.controller == 64) {
-				sustain = msg.control_change.value > 63;
-				if (!sustain) {
-					for (int i = 0; i < smol_vector_count(&notes); i++) {
-						granular_synth_noteoff(&synth, smol_vector_at(&notes, i));
-					}
-				}
-				else {
-					if (!notes.allocation) {
-						smol_vector_init(&notes, 32);
-					}
-				}
-			}
+			event.type = GS_EVENT_CONTROL;
+			event.id = msg.control_change.controller;
+			event.velocity = (float)msg.control_change.value / 127.0f;
 		} break;
+		default: return;
 	}
-}
 
-void draw_grain_info(int id, voice_t* voice, void* data) {
-	smol_canvas_t* canvas = (smol_canvas_t*)data;
+	if (!granular_synth_push_event(&synth, &event)) {
+		fprintf(stderr, "MIDI event queue is full, dropped an event\n");
+	}
+}
 
+void draw_grain_info(smol_canvas_t* canvas, const synth_snapshot_t* snapshot, int id) {
 	// black background
 	//smol_canvas_push_blend(canvas);
 	smol_canvas_push_color(canvas);
@@ -265,19 +237,16 @@ void draw_grain_info(int id, voice_t* voice, void* data) {
 
 	smol_canvas_set_color(canvas, SMOLC_WHITE);
 
-	for (int i = 0; i < GS_VOICE_MAX_GRAINS; i++) {
-		grain_t* grain = &voice->grains[i];
+	int row = 0;
+	for (int i = 0; i < snapshot->num_grains; i++) {
+		const telemetry_grain_t* grain = &snapshot->grains[i];
+		if (grain->voice != id) continue;
 
 		int x = 10 + id * 100;
-		int y = 10 + i * 18;
+		int y = 10 + row * 18;
 
-		char state = 'I';
-		switch (grain->state) {
-			case GRAIN_IDLE: state = 'I'; break;
-			case GRAIN_FINISHED: state = 'F'; break;
-			case GRAIN_PLAYING: state = '>'; break;
-		}
-		smol_canvas_draw_text_formated(canvas, x, y, 1, "G%d: %c%.1f", i, state, grain->time);
+		smol_canvas_draw_text_formated(canvas, x, y, 1, "G%d: >%.1f", row, grain->phase);
+		row++;
 	}
 
 	smol_canvas_pop_color(canvas);
@@ -376,9 +345,18 @@ int main() {
 	printf("channels: %d\n", have.channels);
 	printf("samples: %d\n", have.samples);
 
-	SDL_PauseAudioDevice(device, 0);
+	device_sample_rate = have.freq;
+	deadline_profiler_init(&profiler);
+
+	FILE* profiler_log = fopen("profiler.log", "w");
+	if (!profiler_log) profiler_log = stdout;
+	double profiler_log_timer = 0.0;
+	deadline_stats_t logged_stats = { 0 };
 
-	granular_synth_init(&synth, SAMPLE_RATE, "piano.wav");
+	if (!granular_synth_init(&synth, SAMPLE_RATE, "piano.wav")) {
+		fprintf(stderr, "Failed to initialize the synth\n");
+		return 1;
+	}
 	synth.sample.window_start = 0.0;
 	synth.sample.window_end = synth.sample.window_start + 0.5;
 	synth.grain_settings.grains_per_second = 4;
@@ -387,6 +365,17 @@ int main() {
 	synth.random_settings.position_offset_random = 0.0f;
 	synth.random_settings.size_random = 0.0f;
 
+	// voices draw from their own random streams now, so they can render on several cores
+	int num_workers = gs_cpu_count() - 1;
+	if (num_workers > GS_SYNTH_MAX_VOICES - 1) num_workers = GS_SYNTH_MAX_VOICES - 1;
+	if (num_workers > 0) {
+		num_workers = granular_synth_start_workers(&synth, num_workers);
+	}
+	printf("render workers: %d\n", num_workers);
+
+	// the callback renders the synth, so it may only start once the synth is set up
+	SDL_PauseAudioDevice(device, 0);
+
 	//grain_init(&grain_test);
 	//grain_test.pitch = 1.0f;
 	//grain_test.velocity = 1.0f;
@@ -429,6 +418,22 @@ int main() {
 
 		clock += time;
 
+		// log every interval, and right away when the callback missed a deadline
+		deadline_stats_t stats;
+		deadline_profiler_stats(&profiler, &stats);
+		profiler_log_timer += time;
+		if (stats.callbacks < logged_stats.callbacks) {
+			logged_stats = stats; // cleared by the reset button
+		}
+		if (profiler_log_timer >= PROFILER_LOG_INTERVAL || stats.overruns > logged_stats.overruns || stats.late > logged_stats.late) {
+			if (stats.overruns > logged_stats.overruns || stats.late > logged_stats.late) {
+				fprintf(profiler_log, "xrun: ");
+			}
+			deadline_profiler_log(&stats, profiler_log);
+			logged_stats = stats;
+			profiler_log_timer = 0.0;
+		}
+
 		smol_frame_update(frame);
 
 		SMOL_FRAME_EVENT_LOOP(frame, ev) {
@@ -462,32 +467,30 @@ int main() {
 
 		smol_canvas_clear(&canvas, SMOLC_DARKEST_GREY);
 
-		draw_waveform(&canvas, wvLeft, &synth.sample.buffer, 0);
-		draw_waveform(&canvas, wvRight, &synth.sample.buffer, 1);
+		// the loader may swap the sample at any time, the one picked up here stays valid until leave
+		sample_source_t* sample = sample_manager_enter(&synth.sample.manager, GS_SAMPLE_READER_GUI);
 
-		smol_u32 samplerPerPixel = synth.sample.buffer.num_frames / waveView.width;
+		draw_waveform(&canvas, wvLeft, sample, 0);
+		draw_waveform(&canvas, wvRight, sample, 1);
 
-		for (int i = 0; i < GS_SYNTH_MAX_VOICES; i++) {
-			voice_t* voice = &synth.voices[i];
-			if (voice_is_free(voice)) continue;
+		smol_u32 samplerPerPixel = (smol_u32)(sample->num_frames / waveView.width);
 
-			for (int j = 0; j < GS_VOICE_MAX_GRAINS; j++) {
-				grain_t* grain = &voice->grains[j];
-				if (grain_is_free(grain)) continue;
-
-				draw_grain(&canvas, voice, grain, &synth.sample.buffer, wvFull);
-			}
+		// the audio thread owns the voices, the GUI only looks at the published snapshot
+		const synth_snapshot_t* snapshot = granular_synth_read_telemetry(&synth);
+		for (int i = 0; i < snapshot->num_grains; i++) {
+			draw_grain(&canvas, &snapshot->grains[i], sample, wvFull);
 		}
 
-		draw_guide(&canvas, "LS", &synth.sample.buffer, synth.sample.window_start, wvFull);
-		draw_guide(&canvas, "LE", &synth.sample.buffer, synth.sample.window_end, wvFull);
+		draw_guide(&canvas, "LS", sample, synth.sample.window_start, wvFull);
+		draw_guide(&canvas, "LE", sample, synth.sample.window_end, wvFull);
 
 		gui_begin(&gui);
 
 		static double startTime = 0.1;
 		static double endTime = 0.4;
 
-		double maxTime = (double)(synth.sample.buffer.num_frames - 1) / synth.sample.buffer.sample_rate;
+		double maxTime = (double)(sample->num_frames - 1) / sample->sample_rate;
+		sample_manager_leave(&synth.sample.manager, GS_SAMPLE_READER_GUI);
 
 		rect_t sampleEndRect = rectcut_right(&toolBar, 150);
 		if (gui_spinnerd(&gui, "sampleEnd", sampleEndRect, &endTime, 0.0, maxTime, 0.05, "end: %.2fs")) {
@@ -506,6 +509,26 @@ int main() {
 			}
 		}
 
+		// picks up edits to the file, the audio keeps playing while it loads
+		rect_t sampleReloadRect = rectcut_left(&toolBar, 120);
+		if (gui_button(&gui, "sampleReload", "reload sample", sampleReloadRect)) {
+			granular_synth_load_sample_async(&synth, "piano.wav", SAMPLE_LOAD_RESIDENT);
+		}
+
+		rect_t profilerResetRect = rectcut_left(&toolBar, 120);
+		if (gui_button(&gui, "profilerReset", "reset load", profilerResetRect)) {
+			deadline_profiler_reset(&profiler);
+		}
+
+		// cycles high -> normal -> draft, for when the callback runs out of time
+		static const char* reverbQualityNames[] = { "reverb: high", "reverb: normal", "reverb: draft" };
+		static int reverbQuality = SF_REVERB_QUALITY_HIGH;
+		rect_t reverbQualityRect = rectcut_left(&toolBar, 120);
+		if (gui_button(&gui, "reverbQuality", reverbQualityNames[reverbQuality], reverbQualityRect)) {
+			reverbQuality = (reverbQuality + 1) % 3;
+			granular_synth_set_reverb_quality(&synth, (sf_reverb_quality)reverbQuality);
+		}
+
 		rect_t tuningRect = rectcut_right(&toolBar, 150);
 		if (gui_spinnerf(&gui, "tuning", tuningRect, &synth.tuning, -2.0, 2.0, 0.01, "tuning: %.2f")) {
 			
@@ -513,8 +536,16 @@ int main() {
 
 		gui_end(&gui);
 
-		//granular_synth_for_each_voice(&synth, draw_grain_info, &canvas);
-		//draw_grain_info(0, &voice_test, &canvas);
+		smol_canvas_push_color(&canvas);
+		smol_canvas_set_color(&canvas, stats.overruns > 0 || stats.late > 0 ? SMOLC_RED : SMOLC_WHITE);
+		smol_canvas_draw_text_formated(&canvas, root.x, root.y + root.height - 16, 1,
+			"load %3.0f%%  min %.0f%%  avg %.0f%%  p99 %.0f%%  max %.0f%%  overruns %d  late %d",
+			stats.last_load * 100.0f, stats.min_load * 100.0f, stats.avg_load * 100.0f,
+			stats.p99_load * 100.0f, stats.max_load * 100.0f, stats.overruns, stats.late
+		);
+		smol_canvas_pop_color(&canvas);
+
+		//for (int i = 0; i < GS_SYNTH_MAX_VOICES; i++) draw_grain_info(&canvas, snapshot, i);
 
 		//smol_canvas_push_color(&canvas);
 		//smol_canvas_set_color(&canvas, SMOLC_WHITE);
@@ -535,6 +566,12 @@ int main() {
 	}
 
 	SDL_CloseAudioDevice(device);
+	granular_synth_free(&synth);
+
+	deadline_stats_t stats;
+	deadline_profiler_stats(&profiler, &stats);
+	deadline_profiler_log(&stats, profiler_log);
+	if (profiler_log != stdout) fclose(profiler_log);
 	SDL_Quit();
 
 	//smol_audio_shutdown();
@@ -0,0 +1,250 @@
+#include "platform.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <time.h>
+#	include <unistd.h>
+#endif
+
+typedef struct gs_thread_start_t {
+	gs_thread_proc proc;
+	void* data;
+} gs_thread_start_t;
+
+#ifdef _WIN32
+
+static DWORD WINAPI _gs_thread_entry(LPVOID param) {
+	gs_thread_start_t start = *(gs_thread_start_t*)param;
+	free(param);
+	start.proc(start.data);
+	return 0;
+}
+
+int gs_thread_create(gs_thread_t* thread, gs_thread_proc proc, void* data) {
+	gs_thread_start_t* start = malloc(sizeof(gs_thread_start_t));
+	if (!start) return 0;
+	start->proc = proc;
+	start->data = data;
+
+	HANDLE handle = CreateThread(NULL, 0, &_gs_thread_entry, start, 0, NULL);
+	if (!handle) {
+		free(start);
+		return 0;
+	}
+
+	*thread = handle;
+	return 1;
+}
+
+void gs_thread_join(gs_thread_t* thread) {
+	WaitForSingleObject((HANDLE)*thread, INFINITE);
+	CloseHandle((HANDLE)*thread);
+	*thread = NULL;
+}
+
+void gs_thread_raise_priority(gs_thread_t* thread) {
+	SetThreadPriority((HANDLE)*thread, THREAD_PRIORITY_HIGHEST);
+}
+
+int gs_semaphore_init(gs_semaphore_t* semaphore) {
+	*semaphore = CreateSemaphoreA(NULL, 0, 0x7FFFFFFF, NULL);
+	return *semaphore != NULL;
+}
+
+void gs_semaphore_free(gs_semaphore_t* semaphore) {
+	CloseHandle((HANDLE)*semaphore);
+	*semaphore = NULL;
+}
+
+void gs_semaphore_post(gs_semaphore_t* semaphore) {
+	ReleaseSemaphore((HANDLE)*semaphore, 1, NULL);
+}
+
+void gs_semaphore_wait(gs_semaphore_t* semaphore) {
+	WaitForSingleObject((HANDLE)*semaphore, INFINITE);
+}
+
+int gs_cpu_count(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+double gs_timer(void) {
+	static double inv_frequency = 0.0;
+	if (inv_frequency == 0.0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		inv_frequency = 1.0 / (double)frequency.QuadPart;
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * inv_frequency;
+}
+
+void gs_sleep(double seconds) {
+	Sleep((DWORD)(seconds * 1000.0 + 0.5));
+}
+
+int gs_file_map(gs_file_map_t* map, const char* path) {
+	map->data = NULL;
+	map->size = 0;
+	map->mapping = NULL;
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (map->file == INVALID_HANDLE_VALUE) {
+		map->file = NULL;
+		return 0;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx((HANDLE)map->file, &size) && size.QuadPart > 0 && (unsigned long long)size.QuadPart <= (size_t)-1) {
+		map->mapping = CreateFileMappingA((HANDLE)map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (map->mapping) {
+			map->data = MapViewOfFile((HANDLE)map->mapping, FILE_MAP_READ, 0, 0, 0);
+			map->size = (size_t)size.QuadPart;
+		}
+	}
+
+	if (!map->data) {
+		gs_file_unmap(map);
+		return 0;
+	}
+	return 1;
+}
+
+void gs_file_unmap(gs_file_map_t* map) {
+	if (map->data) UnmapViewOfFile(map->data);
+	if (map->mapping) CloseHandle((HANDLE)map->mapping);
+	if (map->file) CloseHandle((HANDLE)map->file);
+	map->data = NULL;
+	map->size = 0;
+	map->mapping = NULL;
+	map->file = NULL;
+}
+
+#else
+
+static void* _gs_thread_entry(void* param) {
+	gs_thread_start_t start = *(gs_thread_start_t*)param;
+	free(param);
+	start.proc(start.data);
+	return NULL;
+}
+
+int gs_thread_create(gs_thread_t* thread, gs_thread_proc proc, void* data) {
+	gs_thread_start_t* start = malloc(sizeof(gs_thread_start_t));
+	if (!start) return 0;
+	start->proc = proc;
+	start->data = data;
+
+	if (pthread_create(thread, NULL, &_gs_thread_entry, start) != 0) {
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+void gs_thread_join(gs_thread_t* thread) {
+	pthread_join(*thread, NULL);
+}
+
+void gs_thread_raise_priority(gs_thread_t* thread) {
+	(void)thread;
+}
+
+#ifdef __APPLE__
+
+int gs_semaphore_init(gs_semaphore_t* semaphore) {
+	*semaphore = dispatch_semaphore_create(0);
+	return *semaphore != NULL;
+}
+
+void gs_semaphore_free(gs_semaphore_t* semaphore) {
+	dispatch_release(*semaphore);
+}
+
+void gs_semaphore_post(gs_semaphore_t* semaphore) {
+	dispatch_semaphore_signal(*semaphore);
+}
+
+void gs_semaphore_wait(gs_semaphore_t* semaphore) {
+	dispatch_semaphore_wait(*semaphore, DISPATCH_TIME_FOREVER);
+}
+
+#else
+
+int gs_semaphore_init(gs_semaphore_t* semaphore) {
+	return sem_init(semaphore, 0, 0) == 0;
+}
+
+void gs_semaphore_free(gs_semaphore_t* semaphore) {
+	sem_destroy(semaphore);
+}
+
+void gs_semaphore_post(gs_semaphore_t* semaphore) {
+	sem_post(semaphore);
+}
+
+void gs_semaphore_wait(gs_semaphore_t* semaphore) {
+	while (sem_wait(semaphore) != 0) {} // retry when interrupted by a signal
+}
+
+#endif
+
+int gs_cpu_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+double gs_timer(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+void gs_sleep(double seconds) {
+	struct timespec span;
+	span.tv_sec = (time_t)seconds;
+	span.tv_nsec = (long)((seconds - (double)span.tv_sec) * 1e9);
+	while (nanosleep(&span, &span) != 0 && errno == EINTR) {} // sleep the rest when interrupted by a signal
+}
+
+int gs_file_map(gs_file_map_t* map, const char* path) {
+	map->data = NULL;
+	map->size = 0;
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+
+	// the mapping keeps its own reference to the file
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0 && (unsigned long long)info.st_size <= (size_t)-1) {
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			map->data = data;
+			map->size = (size_t)info.st_size;
+		}
+	}
+	close(fd);
+
+	return map->data != NULL;
+}
+
+void gs_file_unmap(gs_file_map_t* map) {
+	if (map->data) munmap((void*)map->data, map->size);
+	map->data = NULL;
+	map->size = 0;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef GS_PLATFORM_H
+#define GS_PLATFORM_H
+
+// atomics, threads, semaphores and file mappings used by the engine
+// Win32 on windows, pthreads (and dispatch semaphores on macOS) everywhere else
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+#if !defined(_WIN32)
+#	include <pthread.h>
+#	ifdef __APPLE__
+#		include <dispatch/dispatch.h>
+#	else
+#		include <semaphore.h>
+#	endif
+#endif
+
+// [ATOMICS] all operations are sequentially consistent, except gs_atomic_load_acquire
+// which is cheaper where a reader only needs to see what was stored before a flag it checks
+#ifdef _MSC_VER
+
+typedef volatile long gs_atomic32_t;
+
+static inline int32_t gs_atomic_load(gs_atomic32_t* a) { return _InterlockedOr(a, 0); }
+static inline void gs_atomic_store(gs_atomic32_t* a, int32_t value) { _InterlockedExchange(a, value); }
+// returns the new value
+static inline int32_t gs_atomic_add(gs_atomic32_t* a, int32_t value) { return _InterlockedExchangeAdd(a, value) + value; }
+// returns the previous value
+static inline int32_t gs_atomic_exchange(gs_atomic32_t* a, int32_t value) { return _InterlockedExchange(a, value); }
+// returns the previous value, the swap happened if it equals expected
+static inline int32_t gs_atomic_cas(gs_atomic32_t* a, int32_t expected, int32_t desired) {
+	return _InterlockedCompareExchange(a, desired, expected);
+}
+#if defined(_M_ARM64)
+static inline int32_t gs_atomic_load_acquire(gs_atomic32_t* a) { return (int32_t)__ldar32((volatile unsigned __int32*)a); }
+#else
+// x86 loads already acquire, the volatile read only has to stay where it is
+static inline int32_t gs_atomic_load_acquire(gs_atomic32_t* a) { return *a; }
+#endif
+
+typedef void* volatile gs_atomic_ptr_t;
+
+static inline void* gs_atomic_load_ptr(gs_atomic_ptr_t* a) { return _InterlockedCompareExchangePointer(a, NULL, NULL); }
+// returns the previous value
+static inline void* gs_atomic_exchange_ptr(gs_atomic_ptr_t* a, void* value) { return _InterlockedExchangePointer(a, value); }
+
+#else
+
+typedef volatile int32_t gs_atomic32_t;
+
+static inline int32_t gs_atomic_load(gs_atomic32_t* a) { return __atomic_load_n(a, __ATOMIC_SEQ_CST); }
+static inline void gs_atomic_store(gs_atomic32_t* a, int32_t value) { __atomic_store_n(a, value, __ATOMIC_SEQ_CST); }
+static inline int32_t gs_atomic_add(gs_atomic32_t* a, int32_t value) { return __atomic_add_fetch(a, value, __ATOMIC_SEQ_CST); }
+static inline int32_t gs_atomic_exchange(gs_atomic32_t* a, int32_t value) { return __atomic_exchange_n(a, value, __ATOMIC_SEQ_CST); }
+static inline int32_t gs_atomic_cas(gs_atomic32_t* a, int32_t expected, int32_t desired) {
+	__atomic_compare_exchange_n(a, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return expected;
+}
+static inline int32_t gs_atomic_load_acquire(gs_atomic32_t* a) { return __atomic_load_n(a, __ATOMIC_ACQUIRE); }
+
+typedef void* volatile gs_atomic_ptr_t;
+
+static inline void* gs_atomic_load_ptr(gs_atomic_ptr_t* a) { return __atomic_load_n(a, __ATOMIC_SEQ_CST); }
+static inline void* gs_atomic_exchange_ptr(gs_atomic_ptr_t* a, void* value) { return __atomic_exchange_n(a, value, __ATOMIC_SEQ_CST); }
+
+#endif
+
+// spin-wait hint
+static inline void gs_cpu_pause(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif defined(_MSC_VER)
+	__yield();
+#elif defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+//
+
+// [THREADS]
+#ifdef _WIN32
+typedef void* gs_thread_t;
+typedef void* gs_semaphore_t;
+#else
+typedef pthread_t gs_thread_t;
+#	ifdef __APPLE__
+typedef dispatch_semaphore_t gs_semaphore_t;
+#	else
+typedef sem_t gs_semaphore_t;
+#	endif
+#endif
+
+typedef void (*gs_thread_proc)(void* data);
+
+// returns 1 on success
+int gs_thread_create(gs_thread_t* thread, gs_thread_proc proc, void* data);
+void gs_thread_join(gs_thread_t* thread);
+// raises a thread above normal priority, for threads the audio callback waits on.
+// a no-op with pthreads, where that needs a realtime policy and privileges
+void gs_thread_raise_priority(gs_thread_t* thread);
+
+int gs_semaphore_init(gs_semaphore_t* semaphore);
+void gs_semaphore_free(gs_semaphore_t* semaphore);
+// never blocks, safe to call from the audio thread
+void gs_semaphore_post(gs_semaphore_t* semaphore);
+void gs_semaphore_wait(gs_semaphore_t* semaphore);
+
+int gs_cpu_count(void);
+
+// monotonic time in seconds, unaffected by wall clock changes
+double gs_timer(void);
+// blocks the calling thread for at least the given time, never call it from the audio thread
+void gs_sleep(double seconds);
+//
+
+// [FILES]
+// read only view of a whole file, the OS pages it in as it is touched
+typedef struct gs_file_map_t {
+	const void* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+} gs_file_map_t;
+
+// returns 1 on success, empty files can not be mapped
+int gs_file_map(gs_file_map_t* map, const char* path);
+void gs_file_unmap(gs_file_map_t* map);
+//
+
+#endif // !GS_PLATFORM_H
@@ -0,0 +1,54 @@
+#ifndef GS_RNG_H
+#define GS_RNG_H
+
+// small seeded generator (xoshiro128+) so every voice owns its random stream
+// nothing is shared between voices, renders with the same seed are identical whatever thread renders them
+
+#include <stdint.h>
+
+typedef struct gs_rng_t {
+	uint32_t s[4];
+} gs_rng_t;
+
+static inline uint32_t _gs_rng_rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+// splitmix64 spreads the seed over the state, so nearby seeds give unrelated streams
+static inline void gs_rng_seed(gs_rng_t* rng, uint64_t seed) {
+	for (int i = 0; i < 4; i += 2) {
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		rng->s[i] = (uint32_t)z;
+		rng->s[i + 1] = (uint32_t)(z >> 32);
+	}
+}
+
+static inline uint32_t gs_rng_next(gs_rng_t* rng) {
+	uint32_t* s = rng->s;
+	const uint32_t result = s[0] + s[3];
+	const uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = _gs_rng_rotl(s[3], 11);
+
+	return result;
+}
+
+// [0, 1), from the top 24 bits (the low bits of xoshiro128+ are weaker)
+static inline float gs_rng_float(gs_rng_t* rng) {
+	return (float)(gs_rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// [minimum, maximum)
+static inline float gs_rng_range(gs_rng_t* rng, float minimum, float maximum) {
+	return minimum + gs_rng_float(rng) * (maximum - minimum);
+}
+
+#endif // !GS_RNG_H
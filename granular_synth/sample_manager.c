@@ -0,0 +1,176 @@
+#include "sample_manager.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GS_SAMPLE_WAIT_INTERVAL 0.001 // seconds between status checks of sample_manager_wait
+
+// sources are allocated with the link that retires them, so swapping never allocates
+// and any number of them can wait for a reader holding on to an old epoch
+struct sample_entry_t {
+	sample_source_t source; // first, published as the entry
+	int32_t retired_epoch;
+	sample_entry_t* next;
+};
+
+// no reader still holds an epoch older than the one the source was retired at
+static int _sample_manager_unused(sample_manager_t* manager, int32_t retired_epoch) {
+	for (int reader = 0; reader < GS_SAMPLE_READERS; reader++) {
+		const int32_t epoch = gs_atomic_load(&manager->reader_epoch[reader]);
+		if (epoch != 0 && (int32_t)((uint32_t)epoch - (uint32_t)retired_epoch) < 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void _sample_manager_reclaim(sample_manager_t* manager) {
+	sample_entry_t** link = &manager->retired;
+	while (*link) {
+		sample_entry_t* entry = *link;
+		if (_sample_manager_unused(manager, entry->retired_epoch)) {
+			*link = entry->next;
+			sample_source_free(&entry->source);
+			free(entry);
+		} else {
+			link = &entry->next;
+		}
+	}
+}
+
+// returns 1 once the new source is current
+static int _sample_manager_swap_in(sample_manager_t* manager, const sample_request_t* request) {
+	sample_entry_t* entry = (sample_entry_t*)malloc(sizeof(sample_entry_t));
+	if (!entry || !sample_source_open(&entry->source, request->path, request->mode)) {
+		free(entry);
+		return 0;
+	}
+
+	// readers that loaded the old pointer announced an epoch before the one it is retired at
+	sample_source_t* old = (sample_source_t*)gs_atomic_exchange_ptr(&manager->current, &entry->source);
+	const int32_t retired_epoch = gs_atomic_add(&manager->epoch, 1);
+	if (old != &manager->empty) {
+		sample_entry_t* retired = (sample_entry_t*)old;
+		retired->retired_epoch = retired_epoch;
+		retired->next = manager->retired;
+		manager->retired = retired;
+	}
+	return 1;
+}
+
+static void _sample_manager_main(void* data) {
+	sample_manager_t* manager = (sample_manager_t*)data;
+
+	for (;;) {
+		// parks until the next request, but keeps polling while retired sources wait for their readers
+		if (!manager->retired) {
+			gs_semaphore_wait(&manager->wake);
+		} else {
+			gs_sleep(GS_SAMPLE_RECLAIM_INTERVAL);
+		}
+		if (gs_atomic_load(&manager->quit)) {
+			break;
+		}
+
+		_sample_manager_reclaim(manager);
+
+		sample_request_t* request = (sample_request_t*)gs_atomic_exchange_ptr(&manager->request, NULL);
+		if (!request) {
+			continue;
+		}
+
+		const int loaded = _sample_manager_swap_in(manager, request);
+		gs_atomic_store(&manager->results[request->id % GS_SAMPLE_RESULTS], loaded ? request->id : -request->id);
+		gs_atomic_store(&manager->done, request->id);
+		free(request);
+	}
+}
+
+int sample_manager_init(sample_manager_t* manager) {
+	memset(manager, 0, sizeof(sample_manager_t));
+	manager->current = &manager->empty;
+	manager->epoch = 1;
+
+	if (!gs_semaphore_init(&manager->wake)) {
+		return 0;
+	}
+	manager->running = gs_thread_create(&manager->thread, _sample_manager_main, manager);
+	if (!manager->running) {
+		gs_semaphore_free(&manager->wake);
+	}
+	return manager->running;
+}
+
+void sample_manager_free(sample_manager_t* manager) {
+	if (manager->running) {
+		gs_atomic_store(&manager->quit, 1);
+		gs_semaphore_post(&manager->wake);
+		gs_thread_join(&manager->thread);
+		gs_semaphore_free(&manager->wake);
+		manager->running = 0;
+	}
+
+	free(gs_atomic_exchange_ptr(&manager->request, NULL));
+	while (manager->retired) {
+		sample_entry_t* entry = manager->retired;
+		manager->retired = entry->next;
+		sample_source_free(&entry->source);
+		free(entry);
+	}
+
+	sample_source_t* current = (sample_source_t*)gs_atomic_exchange_ptr(&manager->current, &manager->empty);
+	if (current != &manager->empty) {
+		sample_source_free(current);
+		free(current); // its entry
+	}
+}
+
+int32_t sample_manager_load(sample_manager_t* manager, const char* path, sample_load_mode mode) {
+	if (!manager->running) {
+		return 0;
+	}
+
+	const size_t length = strlen(path);
+	sample_request_t* request = (sample_request_t*)malloc(sizeof(sample_request_t) + length);
+	if (!request) {
+		return 0;
+	}
+	const int32_t id = gs_atomic_add(&manager->next_id, 1);
+	request->id = id;
+	request->mode = mode;
+	memcpy(request->path, path, length + 1);
+
+	// the loader only ever takes the newest request
+	sample_request_t* replaced = (sample_request_t*)gs_atomic_exchange_ptr(&manager->request, request);
+	if (replaced) {
+		gs_atomic_store(&manager->results[replaced->id % GS_SAMPLE_RESULTS], -replaced->id);
+		free(replaced);
+	}
+	gs_semaphore_post(&manager->wake);
+	return id;
+}
+
+int sample_manager_status(sample_manager_t* manager, int32_t id) {
+	// the loader stores the result before done
+	const int32_t done = gs_atomic_load(&manager->done);
+	const int32_t result = gs_atomic_load(&manager->results[id % GS_SAMPLE_RESULTS]);
+	if (result == id) {
+		return 1;
+	}
+	if (result == -id) {
+		return -1;
+	}
+	return (int32_t)((uint32_t)done - (uint32_t)id) >= 0 ? -1 : 0;
+}
+
+int sample_manager_wait(sample_manager_t* manager, int32_t id) {
+	if (id == 0) {
+		return -1;
+	}
+
+	int status;
+	while ((status = sample_manager_status(manager, id)) == 0) {
+		gs_sleep(GS_SAMPLE_WAIT_INTERVAL);
+	}
+	return status;
+}
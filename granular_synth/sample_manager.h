@@ -0,0 +1,79 @@
+#ifndef GS_SAMPLE_MANAGER_H
+#define GS_SAMPLE_MANAGER_H
+
+#include "platform.h"
+#include "sample_source.h"
+
+#define GS_SAMPLE_READERS 2
+#define GS_SAMPLE_READER_AUDIO 0 // the audio thread (and the render workers it hands voices to)
+#define GS_SAMPLE_READER_GUI 1
+#define GS_SAMPLE_RESULTS 16 // outcomes of the latest requests kept for sample_manager_status
+#define GS_SAMPLE_RECLAIM_INTERVAL 0.005 // seconds between checks for retired sources readers are done with
+
+// publishes the sample grains read from. a loader thread opens (and decodes) new files and swaps them in
+// with one atomic pointer exchange, readers pick the current source up with an atomic load and never wait.
+// reclaiming uses epochs: every swap counts the epoch up and retires the old source at the new value,
+// and each reader announces the oldest epoch it may still use a source from. a retired source is freed
+// once every reader is idle or has moved on to its epoch
+
+typedef struct sample_request_t {
+	int32_t id;
+	sample_load_mode mode;
+	char path[1]; // allocated with the request
+} sample_request_t;
+
+typedef struct sample_entry_t sample_entry_t;
+
+typedef struct sample_manager_t {
+	gs_atomic_ptr_t current; // sample_source_t, the empty source until a load succeeds
+	gs_atomic32_t epoch; // starts at 1
+	gs_atomic32_t reader_epoch[GS_SAMPLE_READERS]; // 0 while the reader holds no source
+	sample_source_t empty;
+
+	sample_entry_t* retired; // loader thread only: replaced sources waiting for their readers, newest first
+
+	gs_thread_t thread;
+	gs_semaphore_t wake;
+	gs_atomic_ptr_t request; // newest request the loader has not picked up, replacing it cancels the older one
+	gs_atomic32_t quit;
+	int running;
+
+	gs_atomic32_t next_id;
+	gs_atomic32_t done; // last request the loader finished with, requests are handled in order
+	gs_atomic32_t results[GS_SAMPLE_RESULTS]; // by id: id once loaded, -id once failed or replaced
+} sample_manager_t;
+
+// starts the loader thread, returns 1 on success
+int sample_manager_init(sample_manager_t* manager);
+// stops the loader and frees every source, no reader may hold one anymore
+void sample_manager_free(sample_manager_t* manager);
+
+// queues path to be opened with mode on the loader thread and swapped in once it is ready. never waits for
+// the load, returns the request id (0 when the loader is not running or the request could not be allocated)
+int32_t sample_manager_load(sample_manager_t* manager, const char* path, sample_load_mode mode);
+// 0 while the request is pending, 1 once it was swapped in, -1 when it failed or a newer request replaced it
+// before the loader got to it (and for requests more than GS_SAMPLE_RESULTS behind the newest)
+int sample_manager_status(sample_manager_t* manager, int32_t id);
+// blocks until the request is finished and returns its status, never call it from the audio thread
+int sample_manager_wait(sample_manager_t* manager, int32_t id);
+
+// readers: announce an epoch, then load the source. it stays valid until the reader announces a later
+// epoch or leaves, and a reader only ever announces epochs at least as new as the last one it announced
+static inline int32_t sample_manager_epoch(sample_manager_t* manager) { return gs_atomic_load(&manager->epoch); }
+static inline void sample_manager_hold(sample_manager_t* manager, int reader, int32_t epoch) {
+	gs_atomic_store(&manager->reader_epoch[reader], epoch);
+}
+static inline sample_source_t* sample_manager_current(sample_manager_t* manager) {
+	return (sample_source_t*)gs_atomic_load_ptr(&manager->current);
+}
+
+// a whole read section: enter, current, leave
+static inline sample_source_t* sample_manager_enter(sample_manager_t* manager, int reader) {
+	sample_manager_hold(manager, reader, sample_manager_epoch(manager));
+	return sample_manager_current(manager);
+}
+static inline void sample_manager_leave(sample_manager_t* manager, int reader) {
+	gs_atomic_store(&manager->reader_epoch[reader], 0);
+}
+
+#endif // !GS_SAMPLE_MANAGER_H
@@ -0,0 +1,738 @@
+#include "sample_source.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static uint16_t _sample_read_u16(const uint8_t* p) {
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t _sample_read_u32(const uint8_t* p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// qoa is big endian
+static uint64_t _sample_read_u64be(const uint8_t* p) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++) {
+		value = value << 8 | p[i];
+	}
+	return value;
+}
+
+// bytes of a qoa frame holding count frames: header, per channel lms state, then 20 frame slices of every channel
+static size_t _sample_qoa_frame_size(int num_channels, int64_t count) {
+	return 8 + 16 * (size_t)num_channels + 8 * (size_t)num_channels * (size_t)((count + 19) / 20);
+}
+
+// walks the riff chunks instead of assuming the canonical 44 byte header
+static int _sample_source_parse_wav(sample_source_t* source) {
+	const uint8_t* data = (const uint8_t*)source->map.data;
+	const size_t size = source->map.size;
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+		return 0;
+	}
+
+	int tag = 0, bits = 0, num_channels = 0, sample_rate = 0;
+	const uint8_t* pcm = NULL;
+	size_t pcm_size = 0;
+
+	size_t offset = 12;
+	while (offset + 8 <= size) {
+		const uint8_t* chunk = data + offset;
+		const size_t chunk_size = _sample_read_u32(chunk + 4);
+		const size_t available = size - offset - 8;
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && chunk_size <= available) {
+			tag = _sample_read_u16(chunk + 8);
+			num_channels = _sample_read_u16(chunk + 10);
+			sample_rate = (int)_sample_read_u32(chunk + 12);
+			bits = _sample_read_u16(chunk + 22);
+			// WAVE_FORMAT_EXTENSIBLE keeps the actual format in the first two bytes of the sub format guid
+			if (tag == 0xFFFE && chunk_size >= 40) {
+				tag = _sample_read_u16(chunk + 32);
+			}
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			// a truncated file plays what it has
+			pcm = chunk + 8;
+			pcm_size = chunk_size < available ? chunk_size : available;
+			break;
+		}
+
+		if (chunk_size > available) break;
+		offset += 8 + chunk_size + (chunk_size & 1);
+	}
+
+	if (tag == 1 && bits == 8) source->format = SAMPLE_FORMAT_U8;
+	else if (tag == 1 && bits == 16) source->format = SAMPLE_FORMAT_S16;
+	else if (tag == 1 && bits == 24) source->format = SAMPLE_FORMAT_S24;
+	else if (tag == 1 && bits == 32) source->format = SAMPLE_FORMAT_S32;
+	else if (tag == 3 && bits == 32) source->format = SAMPLE_FORMAT_F32;
+	else return 0;
+
+	if (!pcm || num_channels < 1 || num_channels > GS_SAMPLE_MAX_CHANNELS || sample_rate <= 0) {
+		return 0;
+	}
+
+	source->pcm = pcm;
+	source->num_channels = num_channels;
+	source->sample_rate = sample_rate;
+	source->frame_bytes = (bits / 8) * num_channels;
+	source->num_frames = (int64_t)(pcm_size / (size_t)source->frame_bytes);
+	source->duration = (double)source->num_frames / sample_rate;
+	return source->num_frames > 0;
+}
+
+// https://qoaformat.org/qoa-specification.pdf, static files only (the sample count is in the header).
+// the smol decoder reads the channel count too late and seeks past the lms state, so it is not used
+static int _sample_source_parse_qoa(sample_source_t* source) {
+	const uint8_t* data = (const uint8_t*)source->map.data;
+	const size_t size = source->map.size;
+	if (size < 16 || memcmp(data, "qoaf", 4) != 0) {
+		return 0;
+	}
+
+	const int64_t num_frames = (int64_t)_sample_read_u64be(data) & 0xFFFFFFFF;
+	const int num_channels = data[8];
+	const int sample_rate = (int)(_sample_read_u64be(data + 8) >> 32 & 0xFFFFFF);
+	if (num_frames == 0 || num_channels < 1 || num_channels > GS_SAMPLE_MAX_CHANNELS || sample_rate <= 0) {
+		return 0;
+	}
+
+	// a truncated file plays its complete qoa frames
+	const size_t full_size = _sample_qoa_frame_size(num_channels, GS_QOA_FRAME_FRAMES);
+	const int64_t last = (num_frames - 1) / GS_QOA_FRAME_FRAMES;
+	const int64_t complete = (int64_t)((size - 8) / full_size);
+	if (complete >= last && (size_t)(size - 8 - last * full_size) >= _sample_qoa_frame_size(num_channels, num_frames - last * GS_QOA_FRAME_FRAMES)) {
+		source->num_frames = num_frames;
+	} else {
+		source->num_frames = (complete < last ? complete : last) * GS_QOA_FRAME_FRAMES;
+	}
+
+	source->format = SAMPLE_FORMAT_QOA;
+	source->pcm = data + 8;
+	source->pcm_size = size - 8;
+	source->num_channels = num_channels;
+	source->sample_rate = sample_rate;
+	source->frame_bytes = 0;
+	source->duration = (double)source->num_frames / sample_rate;
+	return source->num_frames > 0;
+}
+
+// residual by scale factor and quantized value
+static const int32_t _sample_qoa_dequant[16][8] = {
+	{   1,    -1,    3,    -3,    5,    -5,     7,     -7},
+	{   5,    -5,   18,   -18,   32,   -32,    49,    -49},
+	{  16,   -16,   53,   -53,   95,   -95,   147,   -147},
+	{  34,   -34,  113,  -113,  203,  -203,   315,   -315},
+	{  63,   -63,  210,  -210,  378,  -378,   588,   -588},
+	{ 104,  -104,  345,  -345,  621,  -621,   966,   -966},
+	{ 158,  -158,  528,  -528,  950,  -950,  1477,  -1477},
+	{ 228,  -228,  760,  -760, 1368, -1368,  2128,  -2128},
+	{ 316,  -316, 1053, -1053, 1895, -1895,  2947,  -2947},
+	{ 422,  -422, 1405, -1405, 2529, -2529,  3934,  -3934},
+	{ 548,  -548, 1828, -1828, 3290, -3290,  5117,  -5117},
+	{ 696,  -696, 2320, -2320, 4176, -4176,  6496,  -6496},
+	{ 868,  -868, 2893, -2893, 5207, -5207,  8099,  -8099},
+	{1064, -1064, 3548, -3548, 6386, -6386,  9933,  -9933},
+	{1286, -1286, 4288, -4288, 7718, -7718, 12005, -12005},
+	{1536, -1536, 5120, -5120, 9216, -9216, 14336, -14336},
+};
+
+// frames from to to (exclusive) of one qoa frame, interleaved. the lms predictor runs from the start
+// of the qoa frame, so the frames before from are decoded too
+static void _sample_qoa_decode(const sample_source_t* source, int64_t qoa_frame, int from, int to, float* out) {
+	const int num_channels = source->num_channels;
+	const uint8_t* in = source->pcm + qoa_frame * _sample_qoa_frame_size(num_channels, GS_QOA_FRAME_FRAMES);
+	const uint64_t header = _sample_read_u64be(in);
+	const int count = (int)(header >> 16 & 0xFFFF);
+	if ((int)(header >> 56) != num_channels || to > count) {
+		memset(out, 0, sizeof(float) * (to - from) * num_channels);
+		return;
+	}
+	in += 8;
+
+	int32_t history[GS_SAMPLE_MAX_CHANNELS][4], weights[GS_SAMPLE_MAX_CHANNELS][4];
+	for (int channel = 0; channel < num_channels; channel++, in += 16) {
+		const uint64_t h = _sample_read_u64be(in);
+		const uint64_t w = _sample_read_u64be(in + 8);
+		for (int i = 0; i < 4; i++) {
+			history[channel][i] = (int16_t)(h >> (48 - 16 * i));
+			weights[channel][i] = (int16_t)(w >> (48 - 16 * i));
+		}
+	}
+
+	for (int first = 0; first < to; first += 20) {
+		for (int channel = 0; channel < num_channels; channel++, in += 8) {
+			uint64_t slice = _sample_read_u64be(in);
+			const int scale_factor = (int)(slice >> 60);
+			int32_t* h = history[channel];
+			int32_t* w = weights[channel];
+
+			const int end = first + 20 < to ? first + 20 : to;
+			for (int frame = first; frame < end; frame++) {
+				const int32_t residual = _sample_qoa_dequant[scale_factor][(slice >> 57) & 7];
+				slice <<= 3;
+
+				const int32_t prediction = (h[0] * w[0] + h[1] * w[1] + h[2] * w[2] + h[3] * w[3]) >> 13;
+				int32_t value = prediction + residual;
+				value = value < -32768 ? -32768 : value > 32767 ? 32767 : value;
+
+				const int32_t delta = residual >> 4;
+				for (int i = 0; i < 4; i++) {
+					w[i] += h[i] < 0 ? -delta : delta;
+				}
+				h[0] = h[1];
+				h[1] = h[2];
+				h[2] = h[3];
+				h[3] = value;
+
+				if (frame >= from) {
+					out[(frame - from) * num_channels + channel] = (float)value * (1.0f / 32768.0f);
+				}
+			}
+		}
+	}
+}
+
+// interleaved float frames from the mapped pcm, same scaling as the smol wav decoder
+static void _sample_source_decode(const sample_source_t* source, int64_t first, int64_t count, float* out) {
+	const uint8_t* in = source->pcm + first * source->frame_bytes;
+	const size_t num_samples = (size_t)count * source->num_channels;
+
+	switch (source->format) {
+	case SAMPLE_FORMAT_U8:
+		for (size_t i = 0; i < num_samples; i++) {
+			out[i] = (float)in[i] * (1.0f / 255.0f) * 2.0f - 1.0f;
+		}
+		break;
+	case SAMPLE_FORMAT_S16:
+		for (size_t i = 0; i < num_samples; i++, in += 2) {
+			out[i] = (float)(int16_t)_sample_read_u16(in) * (1.0f / 32768.0f);
+		}
+		break;
+	case SAMPLE_FORMAT_S24:
+		for (size_t i = 0; i < num_samples; i++, in += 3) {
+			const int32_t value = (int32_t)((uint32_t)in[0] << 8 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 24) >> 8;
+			out[i] = (float)value * (1.0f / 8388608.0f);
+		}
+		break;
+	case SAMPLE_FORMAT_S32:
+		for (size_t i = 0; i < num_samples; i++, in += 4) {
+			out[i] = (float)(int32_t)_sample_read_u32(in) * (1.0f / 2147483648.0f);
+		}
+		break;
+	case SAMPLE_FORMAT_F32:
+		memcpy(out, in, num_samples * sizeof(float));
+		break;
+	case SAMPLE_FORMAT_QOA:
+		while (count > 0) {
+			const int64_t qoa_frame = first / GS_QOA_FRAME_FRAMES;
+			const int from = (int)(first - qoa_frame * GS_QOA_FRAME_FRAMES);
+			const int n = count < GS_QOA_FRAME_FRAMES - from ? (int)count : GS_QOA_FRAME_FRAMES - from;
+			_sample_qoa_decode(source, qoa_frame, from, from + n, out);
+			out += (size_t)n * source->num_channels;
+			first += n;
+			count -= n;
+		}
+		break;
+	}
+}
+
+// the page holding frame, qoa pages are whole qoa frames
+static inline int32_t _sample_page_of(const sample_source_t* source, int64_t frame) {
+	return source->format == SAMPLE_FORMAT_QOA ? (int32_t)(frame / GS_QOA_FRAME_FRAMES) : (int32_t)(frame >> GS_SAMPLE_PAGE_SHIFT);
+}
+
+static float _sample_half_to_float(uint16_t half) {
+	const uint32_t magnitude = half & 0x7FFFu;
+	const uint32_t exponent = magnitude >> 10;
+	float value = exponent == 0 ? (float)magnitude * (1.0f / 16777216.0f) // subnormal: mantissa * 2^-24
+		: exponent == 31 ? (magnitude & 0x3FFu ? NAN : INFINITY)
+		: ldexpf((float)((magnitude & 0x3FFu) | 0x400u), (int)exponent - 25);
+	return half & 0x8000u ? -value : value;
+}
+
+// round to nearest even, saturating to infinity
+static uint16_t _sample_float_to_half(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	bits &= 0x7FFFFFFFu;
+
+	if (bits >= 0x47800000u) { // 65536 and above, inf and nan
+		return (uint16_t)(sign | (bits > 0x7F800000u ? 0x7E00u : 0x7C00u));
+	}
+	if (bits < 0x38800000u) { // below 2^-14: subnormal, the float add rounds the mantissa into place
+		const uint32_t magic_bits = 0x3F000000u; // 0.5
+		float magic, sum;
+		memcpy(&magic, &magic_bits, sizeof(float));
+		memcpy(&sum, &bits, sizeof(float));
+		sum += magic;
+		memcpy(&bits, &sum, sizeof(float));
+		return (uint16_t)(sign | (bits - magic_bits));
+	}
+	bits += 0xC8000FFFu + ((bits >> 13) & 1u); // rebias the exponent, round the 13 dropped bits
+	return (uint16_t)(sign | (bits >> 13));
+}
+
+// decodes the whole sample into one plane per channel of store_format elements. every plane starts
+// GS_SAMPLE_ALIGN bytes into its share of the store, which leaves a zero guard before it, and the round
+// up to GS_SAMPLE_ALIGN after it always leaves at least GS_SAMPLE_GUARD more
+static int _sample_source_decode_planes(sample_source_t* source, sample_store store_format) {
+	const int num_channels = source->num_channels;
+	const size_t element = store_format == SAMPLE_STORE_F32 ? sizeof(float) : sizeof(uint16_t);
+	const size_t lead = GS_SAMPLE_ALIGN / element;
+	const size_t stride = ((size_t)source->num_frames + lead + GS_SAMPLE_GUARD + lead - 1) & ~(lead - 1);
+
+	source->store = calloc(stride * num_channels + lead, element);
+	if (!source->store) {
+		return 0;
+	}
+	source->store_format = store_format;
+
+	uint8_t* base = (uint8_t*)(((uintptr_t)source->store + GS_SAMPLE_ALIGN - 1) & ~(uintptr_t)(GS_SAMPLE_ALIGN - 1));
+	uint8_t* planes[GS_SAMPLE_MAX_CHANNELS];
+	for (int channel = 0; channel < num_channels; channel++) {
+		planes[channel] = base + (stride * channel + lead) * element;
+		source->planes[channel] = planes[channel];
+	}
+
+	// decoded interleaved a qoa frame at a time (so each one is decoded once) and spread over the planes
+	float* run = malloc(sizeof(float) * GS_QOA_FRAME_FRAMES * num_channels);
+	if (!run) {
+		return 0;
+	}
+	for (int64_t first = 0; first < source->num_frames; first += GS_QOA_FRAME_FRAMES) {
+		const int count = source->num_frames - first < GS_QOA_FRAME_FRAMES ? (int)(source->num_frames - first) : GS_QOA_FRAME_FRAMES;
+		_sample_source_decode(source, first, count, run);
+		for (int channel = 0; channel < num_channels; channel++) {
+			const float* in = run + channel;
+			switch (store_format) {
+			case SAMPLE_STORE_F32: {
+				float* plane = (float*)planes[channel] + first;
+				for (int frame = 0; frame < count; frame++) {
+					plane[frame] = in[frame * num_channels];
+				}
+			} break;
+			case SAMPLE_STORE_S16: {
+				// exact for 16 bit files, deeper ones are rounded
+				int16_t* plane = (int16_t*)planes[channel] + first;
+				for (int frame = 0; frame < count; frame++) {
+					const float value = floorf(in[frame * num_channels] * 32768.0f + 0.5f);
+					plane[frame] = (int16_t)(value < -32768.0f ? -32768.0f : value > 32767.0f ? 32767.0f : value);
+				}
+			} break;
+			case SAMPLE_STORE_F16: {
+				uint16_t* plane = (uint16_t*)planes[channel] + first;
+				for (int frame = 0; frame < count; frame++) {
+					plane[frame] = _sample_float_to_half(in[frame * num_channels]);
+				}
+			} break;
+			}
+		}
+	}
+	free(run);
+	return 1;
+}
+
+static int _sample_cache_init(sample_source_t* source, int num_slots) {
+	sample_page_cache_t* cache = &source->cache;
+	cache->page_frames = source->format == SAMPLE_FORMAT_QOA ? GS_QOA_FRAME_FRAMES : GS_SAMPLE_PAGE_FRAMES;
+	cache->num_pages = _sample_page_of(source, source->num_frames - 1) + 1;
+	cache->num_slots = num_slots;
+	cache->pages = malloc(sizeof(float) * num_slots * cache->page_frames * source->num_channels);
+	cache->page_slot = malloc(sizeof(gs_atomic32_t) * cache->num_pages);
+	cache->slot_page = malloc(sizeof(gs_atomic32_t) * num_slots);
+	cache->slot_used = malloc(sizeof(gs_atomic32_t) * num_slots);
+	cache->free_slots = malloc(sizeof(int32_t) * num_slots);
+	if (!cache->pages || !cache->page_slot || !cache->slot_page || !cache->slot_used || !cache->free_slots) {
+		return 0;
+	}
+
+	for (int page = 0; page < cache->num_pages; page++) {
+		cache->page_slot[page] = GS_PAGE_ABSENT;
+	}
+	for (int slot = 0; slot < num_slots; slot++) {
+		cache->slot_page[slot] = -1;
+		cache->slot_used[slot] = 0;
+		cache->free_slots[slot] = slot;
+	}
+	gs_atomic_store(&cache->free_head, 0);
+	gs_atomic_store(&cache->free_tail, num_slots);
+	gs_atomic_store(&cache->block, 0);
+	gs_atomic_store(&cache->misses, 0);
+	return 1;
+}
+
+static int32_t _sample_cache_take_free(sample_page_cache_t* cache) {
+	for (;;) {
+		const int32_t head = gs_atomic_load(&cache->free_head);
+		if (head == gs_atomic_load(&cache->free_tail)) {
+			return -1;
+		}
+		const int32_t slot = cache->free_slots[(uint32_t)head & (cache->num_slots - 1)];
+		if (gs_atomic_cas(&cache->free_head, head, head + 1) == head) {
+			return slot;
+		}
+	}
+}
+
+// decodes page into a free slot, the page must have been claimed (GS_PAGE_LOADING) by the caller
+// slot_page is set last: once collect sees it, the page is mapped to the slot
+static int32_t _sample_cache_fill(sample_source_t* source, int32_t page) {
+	sample_page_cache_t* cache = &source->cache;
+
+	const int32_t slot = _sample_cache_take_free(cache);
+	if (slot < 0) {
+		gs_atomic_store(&cache->page_slot[page], GS_PAGE_ABSENT);
+		return -1;
+	}
+
+	const int64_t first = (int64_t)page * cache->page_frames;
+	const int64_t count = source->num_frames - first < cache->page_frames ? source->num_frames - first : cache->page_frames;
+	_sample_source_decode(source, first, count, cache->pages + (size_t)slot * cache->page_frames * source->num_channels);
+
+	gs_atomic_store(&cache->slot_used[slot], gs_atomic_load(&cache->block));
+	gs_atomic_store(&cache->page_slot[page], slot);
+	gs_atomic_store(&cache->slot_page[slot], page);
+	return slot;
+}
+
+// the slot holding page, a mapped source decodes it into a free slot when it is not cached yet.
+// -1 when there is no free slot left or another thread is decoding the same page, the caller never waits
+static int32_t _sample_cache_acquire(sample_source_t* source, int32_t page) {
+	sample_page_cache_t* cache = &source->cache;
+
+	int32_t slot = gs_atomic_load_acquire(&cache->page_slot[page]);
+	if (slot >= 0 || source->stream.running) {
+		return slot >= 0 ? slot : -1;
+	}
+	if (slot == GS_PAGE_LOADING || gs_atomic_cas(&cache->page_slot[page], GS_PAGE_ABSENT, GS_PAGE_LOADING) != GS_PAGE_ABSENT) {
+		slot = gs_atomic_load(&cache->page_slot[page]);
+		return slot >= 0 ? slot : -1;
+	}
+	return _sample_cache_fill(source, page);
+}
+
+static const float* _sample_cache_frame(sample_source_t* source, int64_t frame, float* scratch) {
+	sample_page_cache_t* cache = &source->cache;
+
+	const int32_t page = _sample_page_of(source, frame);
+	const int32_t slot = _sample_cache_acquire(source, page);
+	if (slot < 0) {
+		// the render threads never decode for a prefetched source: a streamed mapping could fault in a page
+		// from disk, and a single qoa frame decodes its qoa frame up to it
+		if (source->stream.running) {
+			gs_atomic_add(&cache->misses, 1);
+			return NULL;
+		}
+		_sample_source_decode(source, frame, 1, scratch);
+		return scratch;
+	}
+
+	// most reads hit a slot already marked for this block, they only load
+	const int32_t block = gs_atomic_load_acquire(&cache->block);
+	if (gs_atomic_load_acquire(&cache->slot_used[slot]) != block) {
+		gs_atomic_store(&cache->slot_used[slot], block);
+	}
+
+	const size_t offset = (size_t)slot * cache->page_frames + (size_t)(frame - (int64_t)page * cache->page_frames);
+	return cache->pages + offset * source->num_channels;
+}
+
+void _sample_source_paged_pair(sample_source_t* source, int64_t index, const float** a, const float** b, float* scratch) {
+	const int64_t num_frames = source->num_frames;
+
+	*a = index >= 0 && index < num_frames ? _sample_cache_frame(source, index, scratch) : NULL;
+
+	if (index + 1 < 0 || index + 1 >= num_frames) {
+		*b = NULL;
+	} else if (*a && *a != scratch && _sample_page_of(source, index + 1) == _sample_page_of(source, index)) {
+		*b = *a + source->num_channels; // same page
+	} else {
+		*b = _sample_cache_frame(source, index + 1, scratch + GS_SAMPLE_MAX_CHANNELS);
+	}
+}
+
+static void _sample_stream_wake(sample_source_t* source) {
+	if (gs_atomic_exchange(&source->stream.pending, 1) == 0) {
+		gs_semaphore_post(&source->stream.wake);
+	}
+}
+
+// fills free slots with the missing pages of the region, from its start, until the region is resident
+// or the cache is full. collect wakes it again when it freed slots, set_region when the region moved
+static void _sample_stream_prefetch(void* data) {
+	sample_source_t* source = (sample_source_t*)data;
+	sample_page_cache_t* cache = &source->cache;
+
+	for (;;) {
+		gs_semaphore_wait(&source->stream.wake);
+		gs_atomic_store(&source->stream.pending, 0);
+		if (gs_atomic_load(&source->stream.quit)) {
+			break;
+		}
+
+		const int32_t first = gs_atomic_load(&source->stream.first_page);
+		const int32_t last = gs_atomic_load(&source->stream.last_page);
+		for (int32_t page = first; page <= last; page++) {
+			// restart from the new region (or quit) as soon as the audio thread asks for it
+			if (gs_atomic_load(&source->stream.pending)) break;
+
+			if (gs_atomic_cas(&cache->page_slot[page], GS_PAGE_ABSENT, GS_PAGE_LOADING) != GS_PAGE_ABSENT) continue;
+			if (_sample_cache_fill(source, page) < 0) break;
+		}
+	}
+}
+
+int sample_source_open(sample_source_t* source, const char* path, sample_load_mode mode) {
+	memset(source, 0, sizeof(sample_source_t));
+	if (!gs_file_map(&source->map, path)) {
+		return 0;
+	}
+
+	const int qoa = source->map.size >= 4 && memcmp(source->map.data, "qoaf", 4) == 0;
+	if (!(qoa ? _sample_source_parse_qoa(source) : _sample_source_parse_wav(source))) {
+		sample_source_free(source);
+		return 0;
+	}
+
+	// there is no qoa encoder, a compressed wav is the closest thing: mapped
+	if (mode == SAMPLE_LOAD_QOA && !qoa) {
+		mode = SAMPLE_LOAD_MAPPED;
+	}
+	source->mode = mode;
+
+	if (mode == SAMPLE_LOAD_RESIDENT || mode == SAMPLE_LOAD_RESIDENT_S16 || mode == SAMPLE_LOAD_RESIDENT_F16) {
+		const sample_store store_format = mode == SAMPLE_LOAD_RESIDENT_S16 ? SAMPLE_STORE_S16 : mode == SAMPLE_LOAD_RESIDENT_F16 ? SAMPLE_STORE_F16 : SAMPLE_STORE_F32;
+		if (!_sample_source_decode_planes(source, store_format)) {
+			sample_source_free(source);
+			return 0;
+		}
+		gs_file_unmap(&source->map);
+		source->pcm = NULL;
+		return 1;
+	}
+
+	// the compressed frames are copied so the file is not needed anymore, and never paged out
+	if (mode == SAMPLE_LOAD_QOA) {
+		source->store = malloc(source->pcm_size);
+		if (!source->store) {
+			sample_source_free(source);
+			return 0;
+		}
+		memcpy(source->store, source->pcm, source->pcm_size);
+		source->pcm = (const uint8_t*)source->store;
+		gs_file_unmap(&source->map);
+	}
+
+	// qoa frames only decode from their start, so like a streamed source a qoa source leaves decoding to
+	// the prefetch thread. its cache holds the whole sample when it is short enough
+	if (mode == SAMPLE_LOAD_STREAM || source->format == SAMPLE_FORMAT_QOA) {
+		int num_slots = GS_SAMPLE_STREAM_PAGES;
+		if (mode != SAMPLE_LOAD_STREAM) {
+			const int32_t num_pages = _sample_page_of(source, source->num_frames - 1) + 1;
+			for (num_slots = GS_SAMPLE_CACHE_SPARE; num_slots < num_pages + GS_SAMPLE_CACHE_SPARE && num_slots < GS_SAMPLE_QOA_PAGES; num_slots *= 2) {}
+		}
+		if (!_sample_cache_init(source, num_slots) || !gs_semaphore_init(&source->stream.wake)) {
+			sample_source_free(source);
+			return 0;
+		}
+
+		// until the synth sets one, the region is the start of the sample
+		gs_atomic_store(&source->stream.first_page, 0);
+		gs_atomic_store(&source->stream.last_page, source->cache.num_pages - 1);
+		source->stream.running = gs_thread_create(&source->stream.thread, _sample_stream_prefetch, source);
+		if (!source->stream.running) {
+			gs_semaphore_free(&source->stream.wake);
+			sample_source_free(source);
+			return 0;
+		}
+		_sample_stream_wake(source);
+		return 1;
+	}
+
+	// float32 frames are used in place when the data chunk is aligned for it
+	if (source->format == SAMPLE_FORMAT_F32 && ((uintptr_t)source->pcm & (sizeof(float) - 1)) == 0) {
+		source->frames = (const float*)source->pcm;
+		return 1;
+	}
+
+	if (!_sample_cache_init(source, GS_SAMPLE_CACHE_PAGES)) {
+		sample_source_free(source);
+		return 0;
+	}
+	return 1;
+}
+
+void sample_source_free(sample_source_t* source) {
+	if (source->stream.running) {
+		gs_atomic_store(&source->stream.quit, 1);
+		gs_atomic_store(&source->stream.pending, 1);
+		gs_semaphore_post(&source->stream.wake);
+		gs_thread_join(&source->stream.thread);
+		gs_semaphore_free(&source->stream.wake);
+	}
+
+	free(source->store);
+	free(source->cache.pages);
+	free((void*)source->cache.page_slot);
+	free((void*)source->cache.slot_page);
+	free((void*)source->cache.slot_used);
+	free(source->cache.free_slots);
+	gs_file_unmap(&source->map);
+	memset(source, 0, sizeof(sample_source_t));
+}
+
+float sample_source_read(const sample_source_t* source, int channel, int64_t frame) {
+	if (frame < 0 || frame >= source->num_frames || channel < 0) {
+		return 0.0f;
+	}
+	if (channel >= source->num_channels) {
+		channel = source->num_channels - 1;
+	}
+
+	if (source->planes[0]) {
+		switch (source->store_format) {
+		case SAMPLE_STORE_S16:
+			return (float)((const int16_t*)source->planes[channel])[frame] * (1.0f / 32768.0f);
+		case SAMPLE_STORE_F16:
+			return _sample_half_to_float(((const uint16_t*)source->planes[channel])[frame]);
+		default:
+			return ((const float*)source->planes[channel])[frame];
+		}
+	}
+	if (source->frames) {
+		return source->frames[frame * source->num_channels + channel];
+	}
+	float value[GS_SAMPLE_MAX_CHANNELS];
+	_sample_source_decode(source, frame, 1, value);
+	return value[channel];
+}
+
+void sample_source_read_span(const sample_source_t* source, int channel, int64_t first, int count, float* out) {
+	// the part outside the sample reads 0
+	int skip = first < 0 ? (int)(-first < count ? -first : count) : 0;
+	memset(out, 0, sizeof(float) * skip);
+	first += skip;
+	out += skip;
+	count -= skip;
+
+	const int64_t available = source->num_frames - first;
+	const int n = available <= 0 ? 0 : available < count ? (int)available : count;
+	memset(out + n, 0, sizeof(float) * (count - n));
+	if (n == 0 || channel < 0) {
+		memset(out, 0, sizeof(float) * n);
+		return;
+	}
+	if (channel >= source->num_channels) {
+		channel = source->num_channels - 1;
+	}
+
+	if (source->planes[0] || source->frames) {
+		for (int i = 0; i < n; i++) {
+			out[i] = sample_source_read(source, channel, first + i);
+		}
+		return;
+	}
+
+	float run[1024 * GS_SAMPLE_MAX_CHANNELS];
+	for (int done = 0; done < n; done += 1024) {
+		const int length = n - done < 1024 ? n - done : 1024;
+		_sample_source_decode(source, first + done, length, run);
+		for (int i = 0; i < length; i++) {
+			out[done + i] = run[i * source->num_channels + channel];
+		}
+	}
+}
+
+void sample_source_collect(sample_source_t* source) {
+	sample_page_cache_t* cache = &source->cache;
+	if (!cache->pages) {
+		return;
+	}
+
+	// pages read in the block that just ended carry its number and are never evicted
+	const int32_t block = gs_atomic_add(&cache->block, 1) - 1;
+
+	// a prefetched source never evicts its region
+	const int streamed = source->stream.running;
+	const int32_t first = streamed ? gs_atomic_load(&source->stream.first_page) : 0;
+	const int32_t last = streamed ? gs_atomic_load(&source->stream.last_page) : -1;
+
+	int evicted = 0;
+	int32_t tail = cache->free_tail;
+	while (tail - gs_atomic_load(&cache->free_head) < GS_SAMPLE_CACHE_SPARE) {
+		int victim = -1;
+		int32_t victim_age = 0;
+		for (int slot = 0; slot < cache->num_slots; slot++) {
+			const int32_t page = gs_atomic_load_acquire(&cache->slot_page[slot]);
+			if (page < 0 || (page >= first && page <= last)) continue;
+
+			// the prefetch thread may have stamped a page with the block that starts now
+			const int32_t age = (int32_t)((uint32_t)block - (uint32_t)gs_atomic_load_acquire(&cache->slot_used[slot]));
+			if (age > victim_age) {
+				victim = slot;
+				victim_age = age;
+			}
+		}
+		if (victim < 0) break;
+
+		gs_atomic_store(&cache->page_slot[cache->slot_page[victim]], GS_PAGE_ABSENT);
+		gs_atomic_store(&cache->slot_page[victim], -1);
+		cache->free_slots[(uint32_t)tail & (cache->num_slots - 1)] = victim;
+		gs_atomic_store(&cache->free_tail, ++tail);
+		evicted++;
+	}
+
+	if (streamed && evicted > 0) {
+		_sample_stream_wake(source);
+	}
+}
+
+void sample_source_set_region(sample_source_t* source, double start, double end) {
+	if (!source->stream.running) {
+		return;
+	}
+
+	// one more frame on each side for the interpolation taps
+	int64_t first = (int64_t)floor(start * source->sample_rate) - 1;
+	int64_t last = (int64_t)ceil(end * source->sample_rate) + 1;
+	first = first < 0 ? 0 : _sample_page_of(source, first);
+	last = last < 0 ? 0 : _sample_page_of(source, last);
+	if (last >= source->cache.num_pages) last = source->cache.num_pages - 1;
+	if (first > last) first = last;
+
+	if (first == gs_atomic_load(&source->stream.first_page) && last == gs_atomic_load(&source->stream.last_page)) {
+		return;
+	}
+	gs_atomic_store(&source->stream.first_page, (int32_t)first);
+	gs_atomic_store(&source->stream.last_page, (int32_t)last);
+	_sample_stream_wake(source);
+}
+
+void sample_source_wait_region(sample_source_t* source) {
+	if (!source->stream.running) {
+		return;
+	}
+
+	sample_page_cache_t* cache = &source->cache;
+	for (;;) {
+		int missing = 0, loading = 0;
+		const int32_t last = gs_atomic_load(&source->stream.last_page);
+		for (int32_t page = gs_atomic_load(&source->stream.first_page); page <= last; page++) {
+			const int32_t slot = gs_atomic_load_acquire(&cache->page_slot[page]);
+			if (slot == GS_PAGE_LOADING) loading = 1;
+			else if (slot < 0) missing = 1;
+		}
+
+		// the prefetch thread stops once the cache is full, only collect frees slots again
+		const int full = gs_atomic_load(&cache->free_head) == gs_atomic_load(&cache->free_tail);
+		if (!loading && (!missing || (full && !gs_atomic_load(&source->stream.pending)))) {
+			return;
+		}
+		gs_sleep(GS_SAMPLE_PREFETCH_WAIT_INTERVAL);
+	}
+}
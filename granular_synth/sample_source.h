@@ -0,0 +1,155 @@
+#ifndef GS_SAMPLE_SOURCE_H
+#define GS_SAMPLE_SOURCE_H
+
+// the sample grains read from (a wav or qoa file), either decoded into memory up front or read through a
+// file mapping. qoa files can also be kept compressed in memory, about a fifth of 16 bit pcm.
+// a resident sample is stored one aligned plane per channel with zero guard frames around it, so the
+// grain kernel reads both interpolation taps of any clamped index without bounds checks. the planes can
+// also be kept as int16 or half floats, which halves the memory (and bandwidth) grains read from
+// a mapped float32 wav is used in place, integer pcm is decoded a page at a time the first time it is read
+// and kept in a bounded cache, so only the parts grains actually play ever get decoded or even paged in.
+// a streamed source, and any qoa source that is not resident, leaves all decoding (and every page fault) to
+// a prefetch thread that keeps the region grains can reach resident. render threads only ever look pages up
+// and play silence where one is missing
+
+#include <stdint.h>
+
+#include "platform.h"
+
+#define GS_SAMPLE_MAX_CHANNELS 8
+#define GS_SAMPLE_PAGE_SHIFT 12
+#define GS_SAMPLE_PAGE_FRAMES (1 << GS_SAMPLE_PAGE_SHIFT) // frames decoded at once by a paged source
+#define GS_SAMPLE_CACHE_PAGES 64 // decoded pages a mapped source keeps (power of two), 2 MB for a stereo sample
+#define GS_SAMPLE_STREAM_PAGES 256 // decoded pages a streamed source keeps (power of two), 21 s of 48 kHz audio
+#define GS_SAMPLE_QOA_PAGES 256 // decoded qoa frames a qoa source keeps at most (power of two), 27 s of 48 kHz audio
+#define GS_SAMPLE_CACHE_SPARE 16 // pages sample_source_collect keeps free for the next block
+#define GS_QOA_FRAME_FRAMES 5120 // frames per qoa frame, a qoa page is one qoa frame
+#define GS_SAMPLE_PREFETCH_WAIT_INTERVAL 0.0005 // seconds between checks of sample_source_wait_region
+#define GS_SAMPLE_ALIGN 64 // bytes, resident planes start on a cache line
+#define GS_SAMPLE_GUARD 2 // zero frames at least, before and after each resident plane
+
+#define GS_PAGE_ABSENT -1
+#define GS_PAGE_LOADING -2
+
+typedef enum sample_load_mode {
+	SAMPLE_LOAD_RESIDENT = 0, // decode the whole file up front
+	SAMPLE_LOAD_RESIDENT_S16, // decode up front to int16, lossless for 16 bit files
+	SAMPLE_LOAD_RESIDENT_F16, // decode up front to half floats, 11 significant bits at any level
+	SAMPLE_LOAD_MAPPED, // map the file, float32 is read in place and integer pcm decoded by page (by the render threads, which may fault it in from disk), qoa is prefetched like stream
+	SAMPLE_LOAD_STREAM, // map the file, a prefetch thread decodes the region set by sample_source_set_region
+	SAMPLE_LOAD_QOA, // qoa files: copy the compressed frames into memory, a prefetch thread decodes them by page. wav files load mapped
+} sample_load_mode;
+
+typedef enum sample_format {
+	SAMPLE_FORMAT_U8 = 0,
+	SAMPLE_FORMAT_S16,
+	SAMPLE_FORMAT_S24,
+	SAMPLE_FORMAT_S32,
+	SAMPLE_FORMAT_F32,
+	SAMPLE_FORMAT_QOA
+} sample_format;
+
+// element type of resident planes
+typedef enum sample_store {
+	SAMPLE_STORE_F32 = 0,
+	SAMPLE_STORE_S16, // scaled by 1 / 32768
+	SAMPLE_STORE_F16
+} sample_store;
+
+// slots are filled by render threads (mapped) or the prefetch thread (streamed and qoa) and only ever evicted
+// by sample_source_collect between blocks, so a frame pointer stays valid until the block ends
+typedef struct sample_page_cache_t {
+	float* pages; // num_slots pages of interleaved frames
+	int page_frames; // GS_SAMPLE_PAGE_FRAMES, or GS_QOA_FRAME_FRAMES for qoa
+	gs_atomic32_t* page_slot; // per page of the sample: the slot holding it, GS_PAGE_ABSENT or GS_PAGE_LOADING
+	int num_pages;
+	int num_slots;
+
+	gs_atomic32_t* slot_page; // page held by each slot, -1 while free or being filled
+	gs_atomic32_t* slot_used; // block the slot was last read in
+
+	// free slots: fillers take from head, collect (the only writer) puts them back at tail
+	int32_t* free_slots;
+	gs_atomic32_t free_head, free_tail;
+
+	gs_atomic32_t block; // counted up by collect
+	gs_atomic32_t misses; // frames read before the prefetch thread had their page resident, they played silence
+} sample_page_cache_t;
+
+typedef struct sample_source_t {
+	int sample_rate;
+	int num_channels;
+	int64_t num_frames;
+	double duration;
+	sample_load_mode mode;
+
+	// resident sources: num_frames per channel, GS_SAMPLE_GUARD zero frames are readable on each side
+	const void* planes[GS_SAMPLE_MAX_CHANNELS];
+	sample_store store_format;
+	void* store; // owned memory: the planes, or the file of a compressed qoa source
+
+	const float* frames; // mapped float32 read in place: every interleaved frame, NULL when paged
+
+	// paged sources
+	gs_file_map_t map;
+	const uint8_t* pcm; // first frame (or qoa frame) inside the mapping or store
+	size_t pcm_size;
+	sample_format format;
+	int frame_bytes; // 0 for qoa
+	sample_page_cache_t cache;
+
+	// prefetched sources: streamed, and qoa that is not resident
+	struct {
+		gs_thread_t thread;
+		gs_semaphore_t wake;
+		gs_atomic32_t pending; // wake was posted and the prefetch thread has not picked it up yet
+		gs_atomic32_t quit;
+		gs_atomic32_t first_page, last_page; // region kept resident
+		int running; // the source is prefetched
+	} stream;
+} sample_source_t;
+
+// opens a wav or qoa file, whichever it is. returns 1 on success, the source is left empty (no frames) on failure
+int sample_source_open(sample_source_t* source, const char* path, sample_load_mode mode);
+void sample_source_free(sample_source_t* source);
+
+// one channel of one frame, 0 outside the sample. never touches the cache, safe from any thread.
+// a qoa source that is not resident decodes its qoa frame up to the frame, read runs with sample_source_read_span
+float sample_source_read(const sample_source_t* source, int channel, int64_t frame);
+// one channel of count frames from first, 0 outside the sample. a qoa frame is decoded once per call
+// instead of once per frame read, safe from any thread
+void sample_source_read_span(const sample_source_t* source, int channel, int64_t first, int count, float* out);
+
+// between blocks while no render thread reads: pages unused for the longest are evicted
+// until GS_SAMPLE_CACHE_SPARE slots are free again. a prefetched source keeps its region
+void sample_source_collect(sample_source_t* source);
+
+// prefetched sources: the span (in seconds) grains may read from, its pages are prefetched from the start
+// and a region larger than the cache only gets its start resident. never blocks, other sources ignore it
+void sample_source_set_region(sample_source_t* source, double start, double end);
+// blocks until the region is resident, or as much of it as the cache holds. for offline rendering,
+// never call it from the audio thread
+void sample_source_wait_region(sample_source_t* source);
+
+void _sample_source_paged_pair(sample_source_t* source, int64_t index, const float** a, const float** b, float* scratch);
+
+// resident sources: the index both interpolation taps read from the planes, index and index + 1 are
+// both in the guard frames (reading 0) wherever the unclamped taps were outside the sample
+static inline int64_t sample_source_clamp(const sample_source_t* source, int64_t index) {
+	index = index < -GS_SAMPLE_GUARD ? -GS_SAMPLE_GUARD : index;
+	return index > source->num_frames ? source->num_frames : index;
+}
+
+// render threads, sources without planes: the interleaved frames at index and index + 1 for interpolation, NULL outside the sample
+// (and where a prefetched page is missing). mapped frames that could not get a cache slot are decoded
+// to scratch (2 * GS_SAMPLE_MAX_CHANNELS floats)
+static inline void sample_source_pair(sample_source_t* source, int64_t index, const float** a, const float** b, float* scratch) {
+	if (source->frames) {
+		*a = index >= 0 && index < source->num_frames ? source->frames + index * source->num_channels : NULL;
+		*b = index + 1 >= 0 && index + 1 < source->num_frames ? source->frames + (index + 1) * source->num_channels : NULL;
+		return;
+	}
+	_sample_source_paged_pair(source, index, a, b, scratch);
+}
+
+#endif // !GS_SAMPLE_SOURCE_H
@@ -0,0 +1,222 @@
+#ifndef GS_SIMD_H
+#define GS_SIMD_H
+
+// minimal 4-lane float vector used by the grain kernels and the reverb
+// SSE2 on x86/x64, NEON on ARM and a plain C fallback everywhere else
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define GS_SIMD_SSE2
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#	define GS_SIMD_NEON
+#	include <arm_neon.h>
+#endif
+
+#define GS_SIMD_WIDTH 4
+
+#if defined(GS_SIMD_SSE2)
+
+typedef __m128 gs_f4;
+typedef __m128 gs_m4; // lane mask
+
+static inline gs_f4 gs_f4_zero(void) { return _mm_setzero_ps(); }
+static inline gs_f4 gs_f4_set1(float v) { return _mm_set1_ps(v); }
+static inline gs_f4 gs_f4_set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline gs_f4 gs_f4_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void gs_f4_store(float* p, gs_f4 v) { _mm_storeu_ps(p, v); }
+// widens 4 int16, unscaled
+static inline gs_f4 gs_f4_load_s16(const int16_t* p) {
+	const __m128i v = _mm_loadl_epi64((const __m128i*)p);
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+// widens 4 ieee half floats. SSE2 has no conversion (F16C needs AVX), the exponent is rebiased
+// by a float multiply, which also normalizes subnormals
+static inline gs_f4 gs_f4_load_f16(const uint16_t* p) {
+	const __m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+	const __m128i magnitude = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+	const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, magnitude), 16);
+	const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)), _mm_castsi128_ps(_mm_set1_epi32(0x77800000))); // 2^112
+	const __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7BFF)), _mm_set1_epi32(0x7F800000));
+	return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+
+static inline gs_f4 gs_f4_add(gs_f4 a, gs_f4 b) { return _mm_add_ps(a, b); }
+static inline gs_f4 gs_f4_sub(gs_f4 a, gs_f4 b) { return _mm_sub_ps(a, b); }
+static inline gs_f4 gs_f4_mul(gs_f4 a, gs_f4 b) { return _mm_mul_ps(a, b); }
+static inline gs_f4 gs_f4_div(gs_f4 a, gs_f4 b) { return _mm_div_ps(a, b); }
+static inline gs_f4 gs_f4_min(gs_f4 a, gs_f4 b) { return _mm_min_ps(a, b); }
+static inline gs_f4 gs_f4_max(gs_f4 a, gs_f4 b) { return _mm_max_ps(a, b); }
+// round toward -inf, for |v| < 2^31 (SSE2 has no floor instruction)
+static inline gs_f4 gs_f4_floor(gs_f4 v) {
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+static inline gs_m4 gs_f4_cmple(gs_f4 a, gs_f4 b) { return _mm_cmple_ps(a, b); }
+static inline gs_m4 gs_f4_cmpgt(gs_f4 a, gs_f4 b) { return _mm_cmpgt_ps(a, b); }
+static inline gs_f4 gs_f4_select(gs_m4 mask, gs_f4 a, gs_f4 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline int gs_m4_any(gs_m4 mask) { return _mm_movemask_ps(mask) != 0; }
+
+// swaps lanes 0<->1 and 2<->3
+static inline gs_f4 gs_f4_swap_pairs(gs_f4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+static inline float gs_f4_hsum(gs_f4 v) {
+	__m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuf);
+	shuf = _mm_movehl_ps(shuf, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+#elif defined(GS_SIMD_NEON)
+
+typedef float32x4_t gs_f4;
+typedef uint32x4_t gs_m4;
+
+static inline gs_f4 gs_f4_zero(void) { return vdupq_n_f32(0.0f); }
+static inline gs_f4 gs_f4_set1(float v) { return vdupq_n_f32(v); }
+static inline gs_f4 gs_f4_set(float a, float b, float c, float d) {
+	const float v[4] = { a, b, c, d };
+	return vld1q_f32(v);
+}
+static inline gs_f4 gs_f4_load(const float* p) { return vld1q_f32(p); }
+static inline void gs_f4_store(float* p, gs_f4 v) { vst1q_f32(p, v); }
+static inline gs_f4 gs_f4_load_s16(const int16_t* p) { return vcvtq_f32_s32(vmovl_s16(vld1_s16(p))); }
+static inline gs_f4 gs_f4_load_f16(const uint16_t* p) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+#else
+	// ARMv7 may lack the half conversion, rebias the exponent like the SSE2 version
+	const uint32x4_t h = vmovl_u16(vld1_u16(p));
+	const uint32x4_t magnitude = vandq_u32(h, vdupq_n_u32(0x7FFF));
+	const uint32x4_t sign = vshlq_n_u32(veorq_u32(h, magnitude), 16);
+	const float32x4_t scaled = vmulq_f32(vreinterpretq_f32_u32(vshlq_n_u32(magnitude, 13)), vreinterpretq_f32_u32(vdupq_n_u32(0x77800000)));
+	const uint32x4_t infnan = vandq_u32(vcgtq_u32(magnitude, vdupq_n_u32(0x7BFF)), vdupq_n_u32(0x7F800000));
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(scaled), vorrq_u32(sign, infnan)));
+#endif
+}
+
+static inline gs_f4 gs_f4_add(gs_f4 a, gs_f4 b) { return vaddq_f32(a, b); }
+static inline gs_f4 gs_f4_sub(gs_f4 a, gs_f4 b) { return vsubq_f32(a, b); }
+static inline gs_f4 gs_f4_mul(gs_f4 a, gs_f4 b) { return vmulq_f32(a, b); }
+static inline gs_f4 gs_f4_div(gs_f4 a, gs_f4 b) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return vdivq_f32(a, b);
+#else
+	// ARMv7 has no vector divide, refine the reciprocal estimate twice
+	float32x4_t r = vrecpeq_f32(b);
+	r = vmulq_f32(vrecpsq_f32(b, r), r);
+	r = vmulq_f32(vrecpsq_f32(b, r), r);
+	return vmulq_f32(a, r);
+#endif
+}
+static inline gs_f4 gs_f4_min(gs_f4 a, gs_f4 b) { return vminq_f32(a, b); }
+static inline gs_f4 gs_f4_max(gs_f4 a, gs_f4 b) { return vmaxq_f32(a, b); }
+static inline gs_f4 gs_f4_floor(gs_f4 v) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return vrndmq_f32(v);
+#else
+	// for |v| < 2^31
+	float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(v));
+	return vsubq_f32(t, vbslq_f32(vcgtq_f32(t, v), vdupq_n_f32(1.0f), vdupq_n_f32(0.0f)));
+#endif
+}
+
+static inline gs_m4 gs_f4_cmple(gs_f4 a, gs_f4 b) { return vcleq_f32(a, b); }
+static inline gs_m4 gs_f4_cmpgt(gs_f4 a, gs_f4 b) { return vcgtq_f32(a, b); }
+static inline gs_f4 gs_f4_select(gs_m4 mask, gs_f4 a, gs_f4 b) { return vbslq_f32(mask, a, b); }
+static inline int gs_m4_any(gs_m4 mask) {
+	uint32x2_t m = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+	return (vget_lane_u32(m, 0) | vget_lane_u32(m, 1)) != 0;
+}
+
+static inline gs_f4 gs_f4_swap_pairs(gs_f4 v) { return vrev64q_f32(v); }
+
+static inline float gs_f4_hsum(gs_f4 v) {
+	float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+#else
+
+typedef struct gs_f4 { float v[4]; } gs_f4;
+typedef struct gs_m4 { uint32_t v[4]; } gs_m4;
+
+#define GS_F4_OP(name, expr) \
+	static inline gs_f4 name(gs_f4 a, gs_f4 b) { \
+		gs_f4 r; \
+		for (int i = 0; i < 4; i++) r.v[i] = (expr); \
+		return r; \
+	}
+
+static inline gs_f4 gs_f4_zero(void) { gs_f4 r = { { 0.0f, 0.0f, 0.0f, 0.0f } }; return r; }
+static inline gs_f4 gs_f4_set1(float v) { gs_f4 r = { { v, v, v, v } }; return r; }
+static inline gs_f4 gs_f4_set(float a, float b, float c, float d) { gs_f4 r = { { a, b, c, d } }; return r; }
+static inline gs_f4 gs_f4_load(const float* p) { gs_f4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+static inline void gs_f4_store(float* p, gs_f4 v) { for (int i = 0; i < 4; i++) p[i] = v.v[i]; }
+static inline gs_f4 gs_f4_load_s16(const int16_t* p) { gs_f4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+static inline gs_f4 gs_f4_load_f16(const uint16_t* p) {
+	gs_f4 r;
+	for (int i = 0; i < 4; i++) {
+		const uint32_t magnitude = p[i] & 0x7FFFu;
+		const uint32_t rebias = 0x77800000u; // 2^112
+		uint32_t bits = magnitude << 13;
+		float value, scale;
+		memcpy(&value, &bits, sizeof(float));
+		memcpy(&scale, &rebias, sizeof(float));
+		value *= scale;
+		memcpy(&bits, &value, sizeof(float));
+		bits |= (uint32_t)(p[i] & 0x8000u) << 16 | (magnitude > 0x7BFFu ? 0x7F800000u : 0u);
+		memcpy(&r.v[i], &bits, sizeof(float));
+	}
+	return r;
+}
+
+GS_F4_OP(gs_f4_add, a.v[i] + b.v[i])
+GS_F4_OP(gs_f4_sub, a.v[i] - b.v[i])
+GS_F4_OP(gs_f4_mul, a.v[i] * b.v[i])
+GS_F4_OP(gs_f4_div, a.v[i] / b.v[i])
+GS_F4_OP(gs_f4_min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+GS_F4_OP(gs_f4_max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+#undef GS_F4_OP
+
+static inline gs_f4 gs_f4_floor(gs_f4 v) {
+	gs_f4 r;
+	for (int i = 0; i < 4; i++) r.v[i] = floorf(v.v[i]);
+	return r;
+}
+
+static inline gs_m4 gs_f4_cmple(gs_f4 a, gs_f4 b) {
+	gs_m4 r;
+	for (int i = 0; i < 4; i++) r.v[i] = a.v[i] <= b.v[i] ? 0xFFFFFFFFu : 0u;
+	return r;
+}
+static inline gs_m4 gs_f4_cmpgt(gs_f4 a, gs_f4 b) {
+	gs_m4 r;
+	for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? 0xFFFFFFFFu : 0u;
+	return r;
+}
+static inline gs_f4 gs_f4_select(gs_m4 mask, gs_f4 a, gs_f4 b) {
+	gs_f4 r;
+	for (int i = 0; i < 4; i++) r.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+static inline int gs_m4_any(gs_m4 mask) { return (mask.v[0] | mask.v[1] | mask.v[2] | mask.v[3]) != 0; }
+
+static inline gs_f4 gs_f4_swap_pairs(gs_f4 v) { gs_f4 r = { { v.v[1], v.v[0], v.v[3], v.v[2] } }; return r; }
+
+static inline float gs_f4_hsum(gs_f4 v) { return (v.v[0] + v.v[1]) + (v.v[2] + v.v[3]); }
+
+#endif
+
+static inline gs_f4 gs_f4_clamp(gs_f4 v, gs_f4 low, gs_f4 high) {
+	return gs_f4_min(gs_f4_max(v, low), high);
+}
+
+#endif // !GS_SIMD_H
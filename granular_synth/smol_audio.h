@@ -1247,7 +1247,7 @@ int smol_audiobuffer_save_wav(smol_audiobuffer_t* buffer, const char* file_path,
 #ifndef _CRT_SECURE_NO_WARNINGS
 	fopen_s(&file, file_path, "wb");
 #else 
-	file = fopen(file_path, "w");
+	file = fopen(file_path, "wb");
 #endif 
 	
 	if(!file) return 0;
@@ -1275,14 +1275,9 @@ int smol_audiobuffer_save_wav(smol_audiobuffer_t* buffer, const char* file_path,
 	fwrite((void*)&block_align, 2, 1, file);
 	fwrite((void*)&bps, 2, 1, file);
 	if(sample_type == 3) {
-		smol_u16 valid_bits_per_sample = 32;
-		smol_u16 channel_mask = (buffer->num_channels == 2) ? 3 : 4;
-		smol_u8 bytes[16] = { 0 };
-		fwrite((void*)&valid_bits_per_sample, 8, 2, file);
-		fwrite((void*)&channel_mask, 8, 2, file);
-		fwrite((void*)bytes, 16, 1, file);
-
-
+		//Non-PCM formats carry an (empty) extension size
+		smol_u16 extension_size = 0;
+		fwrite((void*)&extension_size, 2, 1, file);
 	}
 	smol_u32 cur = ftell(file) - 20;
 	fseek(file, 16, SEEK_SET);
@@ -1305,16 +1300,23 @@ int smol_audiobuffer_save_wav(smol_audiobuffer_t* buffer, const char* file_path,
 			for(smol_u32 j = 0; j < buffer->num_frames; j++) 
 			for(smol_u32 i = 0; i < buffer->num_channels; i++)
 			{
-				smol_i16 sample = (double)buffer->samples[j * buffer->num_channels * buffer->stride + i * buffer->stride] * (double)0x7FFF;
+				float value = buffer->samples[j * buffer->num_channels * buffer->stride + i * buffer->stride];
+				value = value < -1.f ? -1.f : (value > 1.f ? 1.f : value);
+				smol_i16 sample = (smol_i16)((double)value * (double)0x7FFF);
 				fwrite((void*)&sample, 2, 1, file);
 			}
+		break;
 		case 24:
 			for(smol_u32 j = 0; j < buffer->num_frames; j++) 
 			for(smol_u32 i = 0; i < buffer->num_channels; i++)
 			{
-				smol_i32 sample = (double)buffer->samples[j * buffer->num_channels * buffer->stride + i * buffer->stride] * (double)0x7FFFFFFFF;
-				fwrite((void*)&sample, 3, 1, file);
+				float value = buffer->samples[j * buffer->num_channels * buffer->stride + i * buffer->stride];
+				value = value < -1.f ? -1.f : (value > 1.f ? 1.f : value);
+				smol_i32 sample = (smol_i32)((double)value * (double)0x7FFFFF);
+				smol_u8 bytes[3] = { (smol_u8)sample, (smol_u8)(sample >> 8), (smol_u8)(sample >> 16) };
+				fwrite((void*)bytes, 3, 1, file);
 			}
+		break;
 		case 32:
 			for(smol_u32 j = 0; j < buffer->num_frames; j++) 
 			for(smol_u32 i = 0; i < buffer->num_channels; i++)
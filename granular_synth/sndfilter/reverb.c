@@ -3,11 +3,13 @@
 // Project Home: https://github.com/velipso/sndfilter
 
 #include "reverb.h"
+#include "../simd.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 // utility functions
@@ -47,13 +49,11 @@ static inline int nextprime(int v){
 }
 
 // generate a random float [0, 1) using a simple (but good quality) RNG
-static inline float randfloat(){
-	static uint32_t seed = 123; // doesn't matter
-	static uint32_t i = 456; // doesn't matter
+static inline float randfloat(sf_rv_noise_st *noise){
 	uint32_t m = 0x5bd1e995;
-	uint32_t k = i++ * m;
-	seed = (k ^ (k >> 24) ^ (seed * m)) * m;
-	uint32_t R = (seed ^ (seed >> 13)) & 0x007FFFFF; // get 23 random bits
+	uint32_t k = noise->counter++ * m;
+	noise->seed = (k ^ (k >> 24) ^ (noise->seed * m)) * m;
+	uint32_t R = (noise->seed ^ (noise->seed >> 13)) & 0x007FFFFF; // get 23 random bits
 	union { uint32_t i; float f; } u = { .i = 0x3F800000 | R };
 	return u.f - 1.0;
 }
@@ -66,39 +66,96 @@ static inline float randfloat(){
 
 // components are in the basic format of `<component>_make` to initialize a structure and
 // `<component>_step` to perform a single step with the component
+//
+// the L/R pairs step as one vector (see the stereo pairs note in reverb.h); arithmetic runs in the
+// vector while the delay line reads and writes go lane by lane since each channel has its own
+// buffer and position. the operations are the same, in the same order, as the scalar code so the
+// result matches it
+
+// lane helpers
+static inline gs_f4 lr_make(float L, float R){
+	return gs_f4_set(L, R, 0.0f, 0.0f);
+}
+
+// per-lane setter for the *_make functions; lane 0 also fills the padding lanes so they never hold
+// garbage (a denormal there would slow down the whole vector)
+static inline void lr_set(float *v, int lane, float x){
+	v[lane] = x;
+	if (lane == 0)
+		v[2] = v[3] = x;
+}
+
+static inline int lr_next(int pos, int size){ // pos + 1 wrapped to size, without the division
+	return ++pos >= size ? 0 : pos;
+}
+
+static inline int lr_back(int pos, int offset, int size){ // pos - offset for 0 <= offset <= size
+	pos -= offset;
+	return pos < 0 ? pos + size : pos;
+}
+
+//
+// arena
+//
+// delay lines are sized by the *_make functions, then *_bind hands out their buffers from the
+// arena in 64-byte aligned slices. binding without memory (base == NULL) only measures the layout
+#define SF_REVERB_ALIGN     16 // floats
+typedef struct {
+	float *base;
+	size_t used;
+} sf_rv_arena_st;
+
+static inline float *arena_take(sf_rv_arena_st *arena, int count){
+	float *buf = NULL;
+	if (arena->base){
+		buf = arena->base + arena->used;
+		memset(buf, 0, sizeof(float) * count);
+	}
+	arena->used += ((size_t)count + SF_REVERB_ALIGN - 1) & ~(size_t)(SF_REVERB_ALIGN - 1);
+	return buf;
+}
 
 //
 // delay
 //
-static inline void delay_make(sf_rv_delay_st *delay, int size){
-	delay->pos = 0;
-	delay->size = clampi(size, 1, SF_REVERB_DS);
-	memset(delay->buf, 0, sizeof(float) * delay->size);
+static inline void delay_make(sf_rv_delay_st *delay, int lane, int size){
+	delay->pos[lane] = 0;
+	delay->size[lane] = clampi(size, 1, SF_REVERB_DS);
+}
+
+static inline void delay_bind(sf_rv_delay_st *delay, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++)
+		delay->buf[c] = arena_take(arena, delay->size[c]);
 }
 
-static inline float delay_step(sf_rv_delay_st *delay, float v){
-	float out = delay->buf[delay->pos];
-	delay->buf[delay->pos] = v;
-	delay->pos = (delay->pos + 1) % delay->size;
+static inline gs_f4 delay_step(sf_rv_delay_st *delay, gs_f4 v){
+	float in[SF_REVERB_LANES];
+	gs_f4_store(in, v);
+	gs_f4 out = lr_make(delay->buf[0][delay->pos[0]], delay->buf[1][delay->pos[1]]);
+	for (int c = 0; c < 2; c++){
+		delay->buf[c][delay->pos[c]] = in[c];
+		delay->pos[c] = lr_next(delay->pos[c], delay->size[c]);
+	}
 	return out;
 }
 
-// delay_get(d, 1) returns the last written value
-// delay_get(d, 2) returns the second-last written value
+// delay_get(d, c, 1) returns the last written value of lane c
+// delay_get(d, c, 2) returns the second-last written value
 // ..etc
-static inline float delay_get(sf_rv_delay_st *delay, int offset){
-	if (offset > delay->size)
-		return delay->buf[delay->pos];
+static inline float delay_get(sf_rv_delay_st *delay, int c, int offset){
+	if (offset > delay->size[c])
+		return delay->buf[c][delay->pos[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int pos = delay->pos - offset;
-	if (pos < 0)
-		pos += delay->size;
-	return delay->buf[pos];
+	return delay->buf[c][lr_back(delay->pos[c], offset, delay->size[c])];
+}
+
+static inline gs_f4 delay_get_lr(sf_rv_delay_st *delay, int offsetL, int offsetR){
+	return lr_make(delay_get(delay, 0, offsetL), delay_get(delay, 1, offsetR));
 }
 
-static inline float delay_getlast(sf_rv_delay_st *delay){
-	return delay->buf[delay->pos];
+static inline gs_f4 delay_getlast(sf_rv_delay_st *delay){
+	return lr_make(delay->buf[0][delay->pos[0]], delay->buf[1][delay->pos[1]]);
 }
 
 //
@@ -125,12 +182,29 @@ static inline void iir1_makeHPF(sf_rv_iir1_st *iir1, int rate, float freq){
 	iir1->y1 = 0;
 }
 
+// both lanes of a pair share the coefficients of a scalar filter
+static inline void iir1_make_lr(sf_rv_iir1_lr_st *iir1, const sf_rv_iir1_st *from){
+	for (int i = 0; i < SF_REVERB_LANES; i++){
+		iir1->a2[i] = from->a2;
+		iir1->b1[i] = from->b1;
+		iir1->b2[i] = from->b2;
+		iir1->y1[i] = 0;
+	}
+}
+
 static inline float iir1_step(sf_rv_iir1_st *iir1, float v){
 	float out = v * iir1->b1 + iir1->y1;
 	iir1->y1 = out * iir1->a2 + v * iir1->b2;
 	return out;
 }
 
+static inline gs_f4 iir1_step_lr(sf_rv_iir1_lr_st *iir1, gs_f4 v){
+	gs_f4 out = gs_f4_add(gs_f4_mul(v, gs_f4_load(iir1->b1)), gs_f4_load(iir1->y1));
+	gs_f4_store(iir1->y1, gs_f4_add(gs_f4_mul(out, gs_f4_load(iir1->a2)),
+		gs_f4_mul(v, gs_f4_load(iir1->b2))));
+	return out;
+}
+
 //
 // biquad
 //
@@ -153,10 +227,6 @@ static inline void biquad_makeLPF(sf_rv_biquad_st *biquad, int rate, float freq,
 		biquad->a1 = a0inv * -2.0f * cs;
 		biquad->a2 = a0inv * (1.0f - alpha);
 	}
-	biquad->xn1 = 0;
-	biquad->xn2 = 0;
-	biquad->yn1 = 0;
-	biquad->yn2 = 0;
 }
 
 static inline void biquad_makeLPFQ(sf_rv_biquad_st *biquad, int rate, float freq, float bw){
@@ -170,10 +240,6 @@ static inline void biquad_makeLPFQ(sf_rv_biquad_st *biquad, int rate, float freq
 	biquad->b2 = biquad->b0;
 	biquad->a1 = a0inv * -2.0f * cs;
 	biquad->a2 = a0inv * (1.0f - alpha);
-	biquad->xn1 = 0;
-	biquad->xn2 = 0;
-	biquad->yn1 = 0;
-	biquad->yn2 = 0;
 }
 
 static inline void biquad_makeAPF(sf_rv_biquad_st *biquad, int rate, float freq, float bw){
@@ -187,19 +253,35 @@ static inline void biquad_makeAPF(sf_rv_biquad_st *biquad, int rate, float freq,
 	biquad->b2 = a0inv * (1.0f + alpha);
 	biquad->a1 = biquad->b1;
 	biquad->a2 = biquad->b0;
-	biquad->xn1 = 0;
-	biquad->xn2 = 0;
-	biquad->yn1 = 0;
-	biquad->yn2 = 0;
-}
-
-static inline float biquad_step(sf_rv_biquad_st *biquad, float v){
-	float out = v * biquad->b0 + biquad->xn1 * biquad->b1 + biquad->xn2 * biquad->b2 -
-		biquad->yn1 * biquad->a1 - biquad->yn2 * biquad->a2;
-	biquad->xn2 = biquad->xn1;
-	biquad->xn1 = v;
-	biquad->yn2 = biquad->yn1;
-	biquad->yn1 = out;
+}
+
+// both lanes of a pair share the coefficients of a scalar filter
+static inline void biquad_make_lr(sf_rv_biquad_lr_st *biquad, const sf_rv_biquad_st *from){
+	for (int i = 0; i < SF_REVERB_LANES; i++){
+		biquad->b0[i] = from->b0;
+		biquad->b1[i] = from->b1;
+		biquad->b2[i] = from->b2;
+		biquad->a1[i] = from->a1;
+		biquad->a2[i] = from->a2;
+		biquad->xn1[i] = 0;
+		biquad->xn2[i] = 0;
+		biquad->yn1[i] = 0;
+		biquad->yn2[i] = 0;
+	}
+}
+
+static inline gs_f4 biquad_step_lr(sf_rv_biquad_lr_st *biquad, gs_f4 v){
+	gs_f4 xn1 = gs_f4_load(biquad->xn1);
+	gs_f4 yn1 = gs_f4_load(biquad->yn1);
+	gs_f4 out = gs_f4_mul(v, gs_f4_load(biquad->b0));
+	out = gs_f4_add(out, gs_f4_mul(xn1, gs_f4_load(biquad->b1)));
+	out = gs_f4_add(out, gs_f4_mul(gs_f4_load(biquad->xn2), gs_f4_load(biquad->b2)));
+	out = gs_f4_sub(out, gs_f4_mul(yn1, gs_f4_load(biquad->a1)));
+	out = gs_f4_sub(out, gs_f4_mul(gs_f4_load(biquad->yn2), gs_f4_load(biquad->a2)));
+	gs_f4_store(biquad->xn2, xn1);
+	gs_f4_store(biquad->xn1, v);
+	gs_f4_store(biquad->yn2, yn1);
+	gs_f4_store(biquad->yn1, out);
 	return out;
 }
 
@@ -220,31 +302,38 @@ static inline void earlyref_make(sf_rv_earlyref_st *earlyref, int rate, float fa
 	earlyref->wet2 = (1.0f - width) * 0.5f;
 
 	int lrdelay = 0.0002f * (float)rate;
-	delay_make(&earlyref->delayRL, lrdelay);
-	delay_make(&earlyref->delayLR, lrdelay);
+	delay_make(&earlyref->delayX, 0, lrdelay);
+	delay_make(&earlyref->delayX, 1, lrdelay);
 
-	biquad_makeAPF(&earlyref->allpassXL, rate, 740.0f, 4.0f);
-	earlyref->allpassXR = earlyref->allpassXL;
+	sf_rv_biquad_st bq;
+	biquad_makeAPF(&bq, rate, 740.0f, 4.0f);
+	biquad_make_lr(&earlyref->allpassX, &bq);
 
-	biquad_makeAPF(&earlyref->allpassL, rate, 150.0f, 4.0f);
-	earlyref->allpassR = earlyref->allpassL;
+	biquad_makeAPF(&bq, rate, 150.0f, 4.0f);
+	biquad_make_lr(&earlyref->allpass, &bq);
 
 	factor *= rate;
 	for (int i = 0; i < 18; i++){
 		earlyref->delaytblL[i] = delaytbl[i].L * factor;
 		earlyref->delaytblR[i] = delaytbl[i].R * factor;
 	}
-	delay_make(&earlyref->delayPWL, earlyref->delaytblL[17] + 10);
-	delay_make(&earlyref->delayPWR, earlyref->delaytblR[17] + 10);
+	delay_make(&earlyref->delayPW, 0, earlyref->delaytblL[17] + 10);
+	delay_make(&earlyref->delayPW, 1, earlyref->delaytblR[17] + 10);
+
+	sf_rv_iir1_st iir1;
+	iir1_makeLPF(&iir1, rate, 20000.0f);
+	iir1_make_lr(&earlyref->lpf, &iir1);
 
-	iir1_makeLPF(&earlyref->lpfL, rate, 20000.0f);
-	earlyref->lpfR = earlyref->lpfL;
+	iir1_makeHPF(&iir1, rate, 4.0f);
+	iir1_make_lr(&earlyref->hpf, &iir1);
+}
 
-	iir1_makeHPF(&earlyref->hpfL, rate, 4.0f);
-	earlyref->hpfR = earlyref->hpfL;
+static inline void earlyref_bind(sf_rv_earlyref_st *earlyref, sf_rv_arena_st *arena){
+	delay_bind(&earlyref->delayPW, arena);
+	delay_bind(&earlyref->delayX, arena);
 }
 
-static inline sf_sample_st earlyref_step(sf_rv_earlyref_st *earlyref, sf_sample_st input){
+static inline gs_f4 earlyref_step(sf_rv_earlyref_st *earlyref, gs_f4 input){
 	static const sf_sample_st gaintbl[18] = {
 		{ 0.841f, 0.842f }, { 0.504f, 0.506f }, { 0.491f, 0.489f }, { 0.379f, 0.382f },
 		{ 0.380f, 0.300f }, { 0.346f, 0.346f }, { 0.289f, 0.290f }, { 0.272f, 0.271f },
@@ -253,27 +342,21 @@ static inline sf_sample_st earlyref_step(sf_rv_earlyref_st *earlyref, sf_sample_
 		{ 0.167f, 0.168f }, { 0.134f, 0.133f }
 	};
 
-	float wetL = 0, wetR = 0;
-	delay_step(&earlyref->delayPWL, input.L);
-	delay_step(&earlyref->delayPWR, input.R);
+	gs_f4 wet = gs_f4_zero();
+	delay_step(&earlyref->delayPW, input);
 	for (int i = 0; i < 18; i++){
-		wetL += gaintbl[i].L * delay_get(&earlyref->delayPWL, earlyref->delaytblL[i]);
-		wetR += gaintbl[i].R * delay_get(&earlyref->delayPWR, earlyref->delaytblR[i]);
+		wet = gs_f4_add(wet, gs_f4_mul(lr_make(gaintbl[i].L, gaintbl[i].R),
+			delay_get_lr(&earlyref->delayPW, earlyref->delaytblL[i], earlyref->delaytblR[i])));
 	}
 
-	float L = delay_step(&earlyref->delayRL, input.R + wetR);
-	L = biquad_step(&earlyref->allpassXL, L);
-	L = biquad_step(&earlyref->allpassL, earlyref->wet1 * wetL + earlyref->wet2 * L);
-	L = iir1_step(&earlyref->hpfL, L);
-	L = iir1_step(&earlyref->lpfL, L);
-
-	float R = delay_step(&earlyref->delayLR, input.L + wetL);
-	R = biquad_step(&earlyref->allpassXR, R);
-	R = biquad_step(&earlyref->allpassR, earlyref->wet1 * wetR + earlyref->wet2 * R);
-	R = iir1_step(&earlyref->hpfR, R);
-	R = iir1_step(&earlyref->lpfR, R);
-
-	return (sf_sample_st){ L, R };
+	// L takes R through the cross delay and vice versa
+	gs_f4 out = delay_step(&earlyref->delayX, gs_f4_swap_pairs(gs_f4_add(input, wet)));
+	out = biquad_step_lr(&earlyref->allpassX, out);
+	out = biquad_step_lr(&earlyref->allpass, gs_f4_add(gs_f4_mul(gs_f4_set1(earlyref->wet1), wet),
+		gs_f4_mul(gs_f4_set1(earlyref->wet2), out)));
+	out = iir1_step_lr(&earlyref->hpf, out);
+	out = iir1_step_lr(&earlyref->lpf, out);
+	return out;
 }
 
 //
@@ -281,29 +364,31 @@ static inline sf_sample_st earlyref_step(sf_rv_earlyref_st *earlyref, sf_sample_
 //
 static inline void oversample_make(sf_rv_oversample_st *oversample, int factor){
 	oversample->factor = clampi(factor, 1, SF_REVERB_OF);
-	biquad_makeLPFQ(&oversample->lpfU, 2 * oversample->factor, 1.0f,
-		0.5773502691896258f); // 1/sqrt(3)
-	oversample->lpfD = oversample->lpfU;
+	sf_rv_biquad_st bq;
+	biquad_makeLPFQ(&bq, 2 * oversample->factor, 1.0f, 0.5773502691896258f); // 1/sqrt(3)
+	biquad_make_lr(&oversample->lpfU, &bq);
+	biquad_make_lr(&oversample->lpfD, &bq);
 }
 
 // output length must be oversample->factor
-static inline void oversample_stepup(sf_rv_oversample_st *oversample, float input, float *output){
+static inline void oversample_stepup(sf_rv_oversample_st *oversample, gs_f4 input, gs_f4 *output){
 	if (oversample->factor == 1){
 		output[0] = input;
 		return;
 	}
-	output[0] = biquad_step(&oversample->lpfU, input * oversample->factor);
+	output[0] = biquad_step_lr(&oversample->lpfU,
+		gs_f4_mul(input, gs_f4_set1((float)oversample->factor)));
 	for (int i = 1; i < oversample->factor; i++)
-		output[i] = biquad_step(&oversample->lpfU, 0);
+		output[i] = biquad_step_lr(&oversample->lpfU, gs_f4_zero());
 }
 
 // input length must be oversample->factor
-static inline float oversample_stepdown(sf_rv_oversample_st *oversample, float *input){
+static inline gs_f4 oversample_stepdown(sf_rv_oversample_st *oversample, gs_f4 *input){
 	if (oversample->factor == 1)
 		return input[0];
-	float out = biquad_step(&oversample->lpfD, input[0]);
+	gs_f4 out = biquad_step_lr(&oversample->lpfD, input[0]);
 	for (int i = 1; i < oversample->factor; i++)
-		biquad_step(&oversample->lpfD, input[i]);
+		biquad_step_lr(&oversample->lpfD, input[i]);
 	return out;
 }
 
@@ -315,15 +400,19 @@ static inline void dccut_make(sf_rv_dccut_st *dccut, int rate, float freq){
 	float ang = 2.0f * (float)M_PI * freq / (float)rate;
 	float sn = sinf(ang);
 	float sqrt3 = 1.7320508075688772f;
-	dccut->gain = (sqrt3 - 2.0f * sn) / (sn + sqrt3 * cosf(ang));
-	dccut->y1 = 0;
-	dccut->y2 = 0;
+	float gain = (sqrt3 - 2.0f * sn) / (sn + sqrt3 * cosf(ang));
+	for (int i = 0; i < SF_REVERB_LANES; i++){
+		dccut->gain[i] = gain;
+		dccut->y1[i] = 0;
+		dccut->y2[i] = 0;
+	}
 }
 
-static inline float dccut_step(sf_rv_dccut_st *dccut, float v){
-	float out = v - dccut->y1 + dccut->gain * dccut->y2;
-	dccut->y1 = v;
-	dccut->y2 = out;
+static inline gs_f4 dccut_step(sf_rv_dccut_st *dccut, gs_f4 v){
+	gs_f4 out = gs_f4_add(gs_f4_sub(v, gs_f4_load(dccut->y1)),
+		gs_f4_mul(gs_f4_load(dccut->gain), gs_f4_load(dccut->y2)));
+	gs_f4_store(dccut->y1, v);
+	gs_f4_store(dccut->y2, out);
 	return out;
 }
 
@@ -332,6 +421,12 @@ static inline float dccut_step(sf_rv_dccut_st *dccut, float v){
 //
 static inline void noise_make(sf_rv_noise_st *noise){
 	noise->pos = SF_REVERB_NS;
+	noise->seed = 123; // doesn't matter
+	noise->counter = 456; // doesn't matter
+}
+
+static inline void noise_bind(sf_rv_noise_st *noise, sf_rv_arena_st *arena){
+	noise->buf = arena_take(arena, SF_REVERB_NS);
 }
 
 static inline float noise_step(sf_rv_noise_st *noise){
@@ -349,7 +444,7 @@ static inline float noise_step(sf_rv_noise_st *noise){
 				float right = left;
 				left = noise->buf[i * len];
 				float midpoint = (left + right) * 0.5f;
-				float newv = midpoint + r * (2.0f * randfloat() - 1.0f); // displace by random amt
+				float newv = midpoint + r * (2.0f * randfloat(noise) - 1.0f); // displace by random amt
 				noise->buf[i * len + (len / 2)] = clampf(newv, -1.0f, 1.0f);
 			}
 			len /= 2;
@@ -392,214 +487,265 @@ static inline float lfo_step(sf_rv_lfo_st *lfo){
 //
 // allpass
 //
-static inline void allpass_make(sf_rv_allpass_st *allpass, int size, float feedback, float decay){
-	allpass->pos = 0;
-	allpass->size = clampi(size, 1, SF_REVERB_APS);
-	allpass->feedback = feedback;
-	allpass->decay = decay;
-	memset(allpass->buf, 0, sizeof(float) * allpass->size);
+static inline void allpass_make(sf_rv_allpass_st *allpass, int lane, int size, float feedback,
+	float decay){
+	allpass->pos[lane] = 0;
+	allpass->size[lane] = clampi(size, 1, SF_REVERB_APS);
+	lr_set(allpass->feedback, lane, feedback);
+	lr_set(allpass->decay, lane, decay);
+}
+
+static inline void allpass_bind(sf_rv_allpass_st *allpass, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++)
+		allpass->buf[c] = arena_take(arena, allpass->size[c]);
 }
 
-static inline float allpass_step(sf_rv_allpass_st *allpass, float v){
-	v += allpass->feedback * allpass->buf[allpass->pos];
-	float out = allpass->decay * allpass->buf[allpass->pos] - allpass->feedback * v;
-	allpass->buf[allpass->pos] = v;
-	allpass->pos = (allpass->pos + 1) % allpass->size;
+static inline gs_f4 allpass_step(sf_rv_allpass_st *allpass, gs_f4 v){
+	gs_f4 feedback = gs_f4_load(allpass->feedback);
+	gs_f4 b = lr_make(allpass->buf[0][allpass->pos[0]], allpass->buf[1][allpass->pos[1]]);
+	v = gs_f4_add(v, gs_f4_mul(feedback, b));
+	gs_f4 out = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass->decay), b), gs_f4_mul(feedback, v));
+	float w[SF_REVERB_LANES];
+	gs_f4_store(w, v);
+	for (int c = 0; c < 2; c++){
+		allpass->buf[c][allpass->pos[c]] = w[c];
+		allpass->pos[c] = lr_next(allpass->pos[c], allpass->size[c]);
+	}
 	return out;
 }
 
 //
 // allpass2
 //
-static inline void allpass2_make(sf_rv_allpass2_st *allpass2, int size1, int size2, float feedback1,
-	float feedback2, float decay1, float decay2){
-	allpass2->pos1 = 0;
-	allpass2->pos2 = 0;
-	allpass2->size1 = clampi(size1, 1, SF_REVERB_AP2S1);
-	allpass2->size2 = clampi(size2, 1, SF_REVERB_AP2S2);
-	allpass2->feedback1 = feedback1;
-	allpass2->feedback2 = feedback2;
-	allpass2->decay1 = decay1;
-	allpass2->decay2 = decay2;
-	memset(allpass2->buf1, 0, sizeof(float) * allpass2->size1);
-	memset(allpass2->buf2, 0, sizeof(float) * allpass2->size2);
-}
-
-static inline float allpass2_step(sf_rv_allpass2_st *allpass2, float v){
-	v += allpass2->feedback2 * allpass2->buf2[allpass2->pos2];
-	float out = allpass2->decay2 * allpass2->buf2[allpass2->pos2] - v * allpass2->feedback2;
-	v += allpass2->feedback1 * allpass2->buf1[allpass2->pos1];
-	allpass2->buf2[allpass2->pos2] = allpass2->decay1 * allpass2->buf1[allpass2->pos1] -
-		v * allpass2->feedback1;
-	allpass2->buf1[allpass2->pos1] = v;
-	allpass2->pos1 = (allpass2->pos1 + 1) % allpass2->size1;
-	allpass2->pos2 = (allpass2->pos2 + 1) % allpass2->size2;
+static inline void allpass2_make(sf_rv_allpass2_st *allpass2, int lane, int size1, int size2,
+	float feedback1, float feedback2, float decay1, float decay2){
+	allpass2->pos1[lane] = 0;
+	allpass2->pos2[lane] = 0;
+	allpass2->size1[lane] = clampi(size1, 1, SF_REVERB_AP2S1);
+	allpass2->size2[lane] = clampi(size2, 1, SF_REVERB_AP2S2);
+	lr_set(allpass2->feedback1, lane, feedback1);
+	lr_set(allpass2->feedback2, lane, feedback2);
+	lr_set(allpass2->decay1, lane, decay1);
+	lr_set(allpass2->decay2, lane, decay2);
+}
+
+static inline void allpass2_bind(sf_rv_allpass2_st *allpass2, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++){
+		allpass2->buf1[c] = arena_take(arena, allpass2->size1[c]);
+		allpass2->buf2[c] = arena_take(arena, allpass2->size2[c]);
+	}
+}
+
+static inline gs_f4 allpass2_step(sf_rv_allpass2_st *allpass2, gs_f4 v){
+	gs_f4 feedback1 = gs_f4_load(allpass2->feedback1);
+	gs_f4 feedback2 = gs_f4_load(allpass2->feedback2);
+	gs_f4 b1 = lr_make(allpass2->buf1[0][allpass2->pos1[0]], allpass2->buf1[1][allpass2->pos1[1]]);
+	gs_f4 b2 = lr_make(allpass2->buf2[0][allpass2->pos2[0]], allpass2->buf2[1][allpass2->pos2[1]]);
+	v = gs_f4_add(v, gs_f4_mul(feedback2, b2));
+	gs_f4 out = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass2->decay2), b2), gs_f4_mul(v, feedback2));
+	v = gs_f4_add(v, gs_f4_mul(feedback1, b1));
+	gs_f4 w2 = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass2->decay1), b1), gs_f4_mul(v, feedback1));
+	float w1s[SF_REVERB_LANES], w2s[SF_REVERB_LANES];
+	gs_f4_store(w1s, v);
+	gs_f4_store(w2s, w2);
+	for (int c = 0; c < 2; c++){
+		allpass2->buf2[c][allpass2->pos2[c]] = w2s[c];
+		allpass2->buf1[c][allpass2->pos1[c]] = w1s[c];
+		allpass2->pos1[c] = lr_next(allpass2->pos1[c], allpass2->size1[c]);
+		allpass2->pos2[c] = lr_next(allpass2->pos2[c], allpass2->size2[c]);
+	}
 	return out;
 }
 
-static inline float allpass2_get1(sf_rv_allpass2_st *allpass2, int offset){
-	if (offset > allpass2->size1)
-		return allpass2->buf1[allpass2->pos1];
+static inline float allpass2_get1(sf_rv_allpass2_st *allpass2, int c, int offset){
+	if (offset > allpass2->size1[c])
+		return allpass2->buf1[c][allpass2->pos1[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int rp = allpass2->pos1 - offset;
-	if (rp < 0)
-		rp += allpass2->size1;
-	return allpass2->buf1[rp];
+	return allpass2->buf1[c][lr_back(allpass2->pos1[c], offset, allpass2->size1[c])];
 }
 
-static inline float allpass2_get2(sf_rv_allpass2_st *allpass2, int offset){
-	if (offset > allpass2->size2)
-		return allpass2->buf2[allpass2->pos2];
+static inline float allpass2_get2(sf_rv_allpass2_st *allpass2, int c, int offset){
+	if (offset > allpass2->size2[c])
+		return allpass2->buf2[c][allpass2->pos2[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int rp = allpass2->pos2 - offset;
-	if (rp < 0)
-		rp += allpass2->size2;
-	return allpass2->buf2[rp];
+	return allpass2->buf2[c][lr_back(allpass2->pos2[c], offset, allpass2->size2[c])];
 }
 
 //
 // allpass3
 //
-static inline void allpass3_make(sf_rv_allpass3_st *allpass3, int size1, int msize1, int size2,
-	int size3, float feedback1, float feedback2, float feedback3, float decay1, float decay2,
-	float decay3){
+static inline void allpass3_make(sf_rv_allpass3_st *allpass3, int lane, int size1, int msize1,
+	int size2, int size3, float feedback1, float feedback2, float feedback3, float decay1,
+	float decay2, float decay3){
 	size1 = clampi(size1, 1, SF_REVERB_AP3S1);
 	msize1 = clampi(msize1, 1, SF_REVERB_AP3M1);
 	if (msize1 > size1)
 		msize1 = size1;
 	int newsize = size1 + msize1;
-	allpass3->rpos1 = (msize1 * 2) % newsize;
-	allpass3->wpos1 = 0;
-	allpass3->pos2 = 0;
-	allpass3->pos3 = 0;
-	allpass3->size1 = newsize;
-	allpass3->msize1 = msize1;
-	allpass3->size2 = clampi(size2, 1, SF_REVERB_AP3S2);
-	allpass3->size3 = clampi(size3, 1, SF_REVERB_AP3S3);
-	allpass3->feedback1 = feedback1;
-	allpass3->feedback2 = feedback2;
-	allpass3->feedback3 = feedback3;
-	allpass3->decay1 = decay1;
-	allpass3->decay2 = decay2;
-	allpass3->decay3 = decay3;
-	memset(allpass3->buf1, 0, sizeof(float) * allpass3->size1);
-	memset(allpass3->buf2, 0, sizeof(float) * allpass3->size2);
-	memset(allpass3->buf3, 0, sizeof(float) * allpass3->size3);
-}
-
-static inline float allpass3_step(sf_rv_allpass3_st *allpass3, float v, float mod){
-	mod = (mod + 1.0f) * (float)allpass3->msize1;
-	float floormod = floorf(mod);
-	float mfrac = mod - floormod;
-	int rpos1 = allpass3->rpos1 - (int)floormod;
-	if (rpos1 < 0)
-		rpos1 += allpass3->size1;
-	int rpos2 = rpos1 - 1;
-	if (rpos2 < 0)
-		rpos2 += allpass3->size1;
-	v += allpass3->feedback3 * allpass3->buf3[allpass3->pos3];
-	float out = allpass3->decay3 * allpass3->buf3[allpass3->pos3] - allpass3->feedback3 * v;
-	v += allpass3->feedback2 * allpass3->buf2[allpass3->pos2];
-	allpass3->buf3[allpass3->pos3] = allpass3->decay2 * allpass3->buf2[allpass3->pos2] -
-		allpass3->feedback2 * v;
-	float tmp = allpass3->buf1[rpos2] * mfrac + allpass3->buf1[rpos1] * (1.0f - mfrac);
-	v += allpass3->feedback1 * tmp;
-	allpass3->buf2[allpass3->pos2] = allpass3->decay1 * tmp - allpass3->feedback1 * v;
-	allpass3->buf1[allpass3->wpos1] = v;
-	allpass3->wpos1 = (allpass3->wpos1 + 1) % allpass3->size1;
-	allpass3->rpos1 = (allpass3->rpos1 + 1) % allpass3->size1;
-	allpass3->pos2 = (allpass3->pos2 + 1) % allpass3->size2;
-	allpass3->pos3 = (allpass3->pos3 + 1) % allpass3->size3;
+	allpass3->rpos1[lane] = (msize1 * 2) % newsize;
+	allpass3->wpos1[lane] = 0;
+	allpass3->pos2[lane] = 0;
+	allpass3->pos3[lane] = 0;
+	allpass3->size1[lane] = newsize;
+	lr_set(allpass3->msize1, lane, (float)msize1);
+	allpass3->size2[lane] = clampi(size2, 1, SF_REVERB_AP3S2);
+	allpass3->size3[lane] = clampi(size3, 1, SF_REVERB_AP3S3);
+	lr_set(allpass3->feedback1, lane, feedback1);
+	lr_set(allpass3->feedback2, lane, feedback2);
+	lr_set(allpass3->feedback3, lane, feedback3);
+	lr_set(allpass3->decay1, lane, decay1);
+	lr_set(allpass3->decay2, lane, decay2);
+	lr_set(allpass3->decay3, lane, decay3);
+}
+
+static inline void allpass3_bind(sf_rv_allpass3_st *allpass3, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++){
+		allpass3->buf1[c] = arena_take(arena, allpass3->size1[c]);
+		allpass3->buf2[c] = arena_take(arena, allpass3->size2[c]);
+		allpass3->buf3[c] = arena_take(arena, allpass3->size3[c]);
+	}
+}
+
+static inline gs_f4 allpass3_step(sf_rv_allpass3_st *allpass3, gs_f4 v, gs_f4 mod){
+	mod = gs_f4_mul(gs_f4_add(mod, gs_f4_set1(1.0f)), gs_f4_load(allpass3->msize1));
+	gs_f4 floormod = gs_f4_floor(mod);
+	gs_f4 mfrac = gs_f4_sub(mod, floormod);
+	float fm[SF_REVERB_LANES], r1[2], r2[2];
+	gs_f4_store(fm, floormod);
+	for (int c = 0; c < 2; c++){
+		int rpos1 = lr_back(allpass3->rpos1[c], (int)fm[c], allpass3->size1[c]);
+		int rpos2 = lr_back(rpos1, 1, allpass3->size1[c]);
+		r1[c] = allpass3->buf1[c][rpos1];
+		r2[c] = allpass3->buf1[c][rpos2];
+	}
+	gs_f4 feedback1 = gs_f4_load(allpass3->feedback1);
+	gs_f4 feedback2 = gs_f4_load(allpass3->feedback2);
+	gs_f4 feedback3 = gs_f4_load(allpass3->feedback3);
+	gs_f4 b2 = lr_make(allpass3->buf2[0][allpass3->pos2[0]], allpass3->buf2[1][allpass3->pos2[1]]);
+	gs_f4 b3 = lr_make(allpass3->buf3[0][allpass3->pos3[0]], allpass3->buf3[1][allpass3->pos3[1]]);
+	v = gs_f4_add(v, gs_f4_mul(feedback3, b3));
+	gs_f4 out = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass3->decay3), b3), gs_f4_mul(feedback3, v));
+	v = gs_f4_add(v, gs_f4_mul(feedback2, b2));
+	gs_f4 w3 = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass3->decay2), b2), gs_f4_mul(feedback2, v));
+	gs_f4 tmp = gs_f4_add(gs_f4_mul(lr_make(r2[0], r2[1]), mfrac),
+		gs_f4_mul(lr_make(r1[0], r1[1]), gs_f4_sub(gs_f4_set1(1.0f), mfrac)));
+	v = gs_f4_add(v, gs_f4_mul(feedback1, tmp));
+	gs_f4 w2 = gs_f4_sub(gs_f4_mul(gs_f4_load(allpass3->decay1), tmp), gs_f4_mul(feedback1, v));
+	float w1s[SF_REVERB_LANES], w2s[SF_REVERB_LANES], w3s[SF_REVERB_LANES];
+	gs_f4_store(w1s, v);
+	gs_f4_store(w2s, w2);
+	gs_f4_store(w3s, w3);
+	for (int c = 0; c < 2; c++){
+		allpass3->buf3[c][allpass3->pos3[c]] = w3s[c];
+		allpass3->buf2[c][allpass3->pos2[c]] = w2s[c];
+		allpass3->buf1[c][allpass3->wpos1[c]] = w1s[c];
+		allpass3->wpos1[c] = lr_next(allpass3->wpos1[c], allpass3->size1[c]);
+		allpass3->rpos1[c] = lr_next(allpass3->rpos1[c], allpass3->size1[c]);
+		allpass3->pos2[c] = lr_next(allpass3->pos2[c], allpass3->size2[c]);
+		allpass3->pos3[c] = lr_next(allpass3->pos3[c], allpass3->size3[c]);
+	}
 	return out;
 }
 
-static inline float allpass3_get1(sf_rv_allpass3_st *allpass3, int offset){
-	if (offset > allpass3->size1)
-		return allpass3->buf1[allpass3->rpos1];
+static inline float allpass3_get1(sf_rv_allpass3_st *allpass3, int c, int offset){
+	if (offset > allpass3->size1[c])
+		return allpass3->buf1[c][allpass3->rpos1[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int rp = allpass3->rpos1 - offset;
-	if (rp < 0)
-		rp += allpass3->size1;
-	return allpass3->buf1[rp];
+	return allpass3->buf1[c][lr_back(allpass3->rpos1[c], offset, allpass3->size1[c])];
 }
 
-static inline float allpass3_get2(sf_rv_allpass3_st *allpass3, int offset){
-	if (offset > allpass3->size2)
-		return allpass3->buf2[allpass3->pos2];
+static inline float allpass3_get2(sf_rv_allpass3_st *allpass3, int c, int offset){
+	if (offset > allpass3->size2[c])
+		return allpass3->buf2[c][allpass3->pos2[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int rp = allpass3->pos2 - offset;
-	if (rp < 0)
-		rp += allpass3->size2;
-	return allpass3->buf2[rp];
+	return allpass3->buf2[c][lr_back(allpass3->pos2[c], offset, allpass3->size2[c])];
 }
 
-static inline float allpass3_get3(sf_rv_allpass3_st *allpass3, int offset){
-	if (offset > allpass3->size3)
-		return allpass3->buf3[allpass3->pos3];
+static inline float allpass3_get3(sf_rv_allpass3_st *allpass3, int c, int offset){
+	if (offset > allpass3->size3[c])
+		return allpass3->buf3[c][allpass3->pos3[c]];
 	else if (offset <= 0)
 		offset = 1;
-	int rp = allpass3->pos3 - offset;
-	if (rp < 0)
-		rp += allpass3->size3;
-	return allpass3->buf3[rp];
+	return allpass3->buf3[c][lr_back(allpass3->pos3[c], offset, allpass3->size3[c])];
 }
 
 //
 // allpassm
 //
-static inline void allpassm_make(sf_rv_allpassm_st *allpassm, int size, int msize, float feedback,
-	float decay){
+static inline void allpassm_make(sf_rv_allpassm_st *allpassm, int lane, int size, int msize,
+	float feedback, float decay){
 	size = clampi(size, 1, SF_REVERB_APMS);
 	msize = clampi(msize, 1, SF_REVERB_APMM);
 	if (msize > size)
 		msize = size;
 	int newsize = size + msize;
-	allpassm->rpos = (msize * 2) % newsize;
-	allpassm->wpos = 0;
-	allpassm->size = newsize;
-	allpassm->msize = msize;
-	allpassm->feedback = feedback;
-	allpassm->decay = decay;
-	allpassm->z1 = 0;
-	memset(allpassm->buf, 0, sizeof(float) * allpassm->size);
-}
-
-static inline float allpassm_step(sf_rv_allpassm_st *allpassm, float v, float mod, float fbmod){
-	float mfeedback = allpassm->feedback + fbmod;
-	mod = (mod + 1.0f) * (float)allpassm->msize;
-	float floormod = floorf(mod);
-	float mfrac = 1.0f - mod + floormod;
-	int rpos1 = allpassm->rpos - (int)floormod;
-	if (rpos1 < 0)
-		rpos1 += allpassm->size;
-	int rpos2 = rpos1 - 1;
-	if (rpos2 < 0)
-		rpos2 += allpassm->size;
-	allpassm->z1 = allpassm->buf[rpos2] + mfrac * (allpassm->buf[rpos1] - allpassm->z1);
-	allpassm->rpos = (allpassm->rpos + 1) % allpassm->size;
-	allpassm->buf[allpassm->wpos] = v + allpassm->z1 * mfeedback;
-	v = allpassm->decay * allpassm->z1 - allpassm->buf[allpassm->wpos] * mfeedback;
-	allpassm->wpos = (allpassm->wpos + 1) % allpassm->size;
-	return v;
+	allpassm->rpos[lane] = (msize * 2) % newsize;
+	allpassm->wpos[lane] = 0;
+	allpassm->size[lane] = newsize;
+	lr_set(allpassm->msize, lane, (float)msize);
+	lr_set(allpassm->feedback, lane, feedback);
+	lr_set(allpassm->decay, lane, decay);
+	lr_set(allpassm->z1, lane, 0);
+}
+
+static inline void allpassm_bind(sf_rv_allpassm_st *allpassm, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++)
+		allpassm->buf[c] = arena_take(arena, allpassm->size[c]);
+}
+
+static inline gs_f4 allpassm_step(sf_rv_allpassm_st *allpassm, gs_f4 v, gs_f4 mod, gs_f4 fbmod){
+	gs_f4 mfeedback = gs_f4_add(gs_f4_load(allpassm->feedback), fbmod);
+	mod = gs_f4_mul(gs_f4_add(mod, gs_f4_set1(1.0f)), gs_f4_load(allpassm->msize));
+	gs_f4 floormod = gs_f4_floor(mod);
+	gs_f4 mfrac = gs_f4_add(gs_f4_sub(gs_f4_set1(1.0f), mod), floormod);
+	float fm[SF_REVERB_LANES], r1[2], r2[2];
+	gs_f4_store(fm, floormod);
+	for (int c = 0; c < 2; c++){
+		int rpos1 = lr_back(allpassm->rpos[c], (int)fm[c], allpassm->size[c]);
+		int rpos2 = lr_back(rpos1, 1, allpassm->size[c]);
+		r1[c] = allpassm->buf[c][rpos1];
+		r2[c] = allpassm->buf[c][rpos2];
+		allpassm->rpos[c] = lr_next(allpassm->rpos[c], allpassm->size[c]);
+	}
+	gs_f4 z1 = gs_f4_add(lr_make(r2[0], r2[1]),
+		gs_f4_mul(mfrac, gs_f4_sub(lr_make(r1[0], r1[1]), gs_f4_load(allpassm->z1))));
+	gs_f4_store(allpassm->z1, z1);
+	gs_f4 w = gs_f4_add(v, gs_f4_mul(z1, mfeedback));
+	float ws[SF_REVERB_LANES];
+	gs_f4_store(ws, w);
+	for (int c = 0; c < 2; c++){
+		allpassm->buf[c][allpassm->wpos[c]] = ws[c];
+		allpassm->wpos[c] = lr_next(allpassm->wpos[c], allpassm->size[c]);
+	}
+	return gs_f4_sub(gs_f4_mul(gs_f4_load(allpassm->decay), z1), gs_f4_mul(w, mfeedback));
 }
 
 //
 // comb
 //
-static inline void comb_make(sf_rv_comb_st *comb, int size){
-	comb->pos = 0;
-	comb->size = clampi(size, 1, SF_REVERB_CS);
-	memset(comb->buf, 0, sizeof(float) * comb->size);
+static inline void comb_make(sf_rv_comb_st *comb, int lane, int size){
+	comb->pos[lane] = 0;
+	comb->size[lane] = clampi(size, 1, SF_REVERB_CS);
+}
+
+static inline void comb_bind(sf_rv_comb_st *comb, sf_rv_arena_st *arena){
+	for (int c = 0; c < 2; c++)
+		comb->buf[c] = arena_take(arena, comb->size[c]);
 }
 
-static inline float comb_step(sf_rv_comb_st *comb, float v, float feedback){
-	v = comb->buf[comb->pos] * feedback + v;
-	comb->buf[comb->pos] = v;
-	comb->pos = (comb->pos + 1) % comb->size;
+static inline gs_f4 comb_step(sf_rv_comb_st *comb, gs_f4 v, gs_f4 feedback){
+	gs_f4 b = lr_make(comb->buf[0][comb->pos[0]], comb->buf[1][comb->pos[1]]);
+	v = gs_f4_add(gs_f4_mul(b, feedback), v);
+	float w[SF_REVERB_LANES];
+	gs_f4_store(w, v);
+	for (int c = 0; c < 2; c++){
+		comb->buf[c][comb->pos[c]] = w[c];
+		comb->pos[c] = lr_next(comb->pos[c], comb->size[c]);
+	}
 	return v;
 }
 
@@ -611,7 +757,29 @@ static inline float comb_step(sf_rv_comb_st *comb, float v, float feedback){
 
 // now that all the components are done (thank god), we can start on the actual reverb effect
 
-void sf_presetreverb(sf_reverb_state_st *rv, int rate, sf_reverb_preset preset){
+// hands out the delay lines in the order sf_reverb_process walks through them, so one sample's
+// worth of work moves forward through the arena
+static void reverb_bind(sf_reverb_state_st *rv, sf_rv_arena_st *arena){
+	earlyref_bind(&rv->earlyref, arena);
+	for (int i = 0; i < 10; i++)
+		allpassm_bind(&rv->diff[i], arena);
+	for (int i = 0; i < 4; i++)
+		allpass_bind(&rv->cross[i], arena);
+	allpassm_bind(&rv->dampap1, arena);
+	delay_bind(&rv->dampd, arena);
+	allpassm_bind(&rv->dampap2, arena);
+	delay_bind(&rv->cbassd1, arena);
+	allpass2_bind(&rv->cbassap1, arena);
+	delay_bind(&rv->cbassd2, arena);
+	allpass3_bind(&rv->cbassap2, arena);
+	delay_bind(&rv->cdelay, arena);
+	comb_bind(&rv->comb, arena);
+	delay_bind(&rv->lastdelay, arena);
+	delay_bind(&rv->inpdelay, arena);
+	noise_bind(&rv->noise, arena); // refilled in one go every SF_REVERB_NS samples, keep it out of the way
+}
+
+bool sf_presetreverb(sf_reverb_state_st *rv, int rate, sf_reverb_preset preset){
 	// sorry for the bad formatting, I've tried to cram this in as best as I could
 	struct {
 		int osf; float p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16;
@@ -641,9 +809,9 @@ void sf_presetreverb(sf_reverb_state_st *rv, int rate, sf_reverb_preset preset){
 	};
 
 	#define CASE(prs, i)                                                                        \
-		case prs: sf_advancereverb(rv, rate, ps[i].osf, ps[i].p1, ps[i].p2, ps[i].p3, ps[i].p4, \
-			ps[i].p5, ps[i].p6, ps[i].p7, ps[i].p8, ps[i].p9, ps[i].p10, ps[i].p11, ps[i].p12,  \
-			ps[i].p13, ps[i].p14, ps[i].p15, ps[i].p16); return;
+		case prs: return sf_advancereverb(rv, rate, ps[i].osf, ps[i].p1, ps[i].p2, ps[i].p3, \
+			ps[i].p4, ps[i].p5, ps[i].p6, ps[i].p7, ps[i].p8, ps[i].p9, ps[i].p10, ps[i].p11,   \
+			ps[i].p12, ps[i].p13, ps[i].p14, ps[i].p15, ps[i].p16);
 	switch (preset){
 		CASE(SF_REVERB_PRESET_DEFAULT    ,  0)
 		CASE(SF_REVERB_PRESET_SMALLHALL1 ,  1)
@@ -666,12 +834,34 @@ void sf_presetreverb(sf_reverb_state_st *rv, int rate, sf_reverb_preset preset){
 		CASE(SF_REVERB_PRESET_LONGREVERB2, 18)
 	}
 	#undef CASE
+	return false;
 }
 
-void sf_advancereverb(sf_reverb_state_st *rv, int rate,
-	int oversamplefactor, float ertolate, float erefwet, float dry, float ereffactor,
-	float erefwidth, float width, float wet, float wander, float bassb, float spin, float inputlpf,
-	float basslpf, float damplpf, float outputlpf, float rt60, float delay){
+// quality tiers, in sf_reverb_quality order
+static const struct {
+	int maxfactor;   // oversampling cap
+	int diffstages;  // diffusion stages
+	bool modulation;
+} qualitytbl[] = {
+	{ SF_REVERB_OF, 10, true  }, // high
+	{ 1           ,  8, true  }, // normal
+	{ 1           ,  4, false }  // draft
+};
+
+// builds every component (but not the buffers) from rv->params for a quality tier
+static void reverb_make(sf_reverb_state_st *rv, sf_reverb_quality quality){
+	const sf_rv_params_st *p = &rv->params;
+	int rate = p->rate;
+	int oversamplefactor = p->oversamplefactor;
+	float ertolate = p->ertolate, erefwet = p->erefwet, dry = p->dry, ereffactor = p->ereffactor;
+	float erefwidth = p->erefwidth, width = p->width, wet = p->wet, wander = p->wander;
+	float bassb = p->bassb, spin = p->spin, inputlpf = p->inputlpf, basslpf = p->basslpf;
+	float damplpf = p->damplpf, outputlpf = p->outputlpf, rt60 = p->rt60, delay = p->delay;
+
+	if (oversamplefactor > qualitytbl[quality].maxfactor)
+		oversamplefactor = qualitytbl[quality].maxfactor;
+	rv->diffstages = qualitytbl[quality].diffstages;
+	rv->modulation = qualitytbl[quality].modulation;
 
 	rv->ertolate = ertolate;
 	rv->erefwet = db2lin(erefwet);
@@ -684,12 +874,10 @@ void sf_advancereverb(sf_reverb_state_st *rv, int rate,
 
 	earlyref_make(&rv->earlyref, rate, ereffactor, erefwidth);
 
-	oversample_make(&rv->oversampleL, oversamplefactor);
-	rv->oversampleR = rv->oversampleL;
-	int osrate = rate * rv->oversampleL.factor;
+	oversample_make(&rv->oversample, oversamplefactor);
+	int osrate = rate * rv->oversample.factor;
 
-	dccut_make(&rv->dccutL, osrate, 5.0f);
-	rv->dccutR = rv->dccutL;
+	dccut_make(&rv->dccut, osrate, 5.0f);
 
 	noise_make(&rv->noise);
 
@@ -703,37 +891,39 @@ void sf_advancereverb(sf_reverb_state_st *rv, int rate,
 	int totfactor = osrate / 34125;
 	int msize = nextprime(10 * osrate / 34125);
 	for (int i = 0; i < 10; i++){
-		allpassm_make(&rv->diffL[i], nextprime(diffLc[i] * totfactor), msize, -0.78f, 1);
-		allpassm_make(&rv->diffR[i], nextprime(diffRc[i] * totfactor), msize, -0.78f, 1);
+		allpassm_make(&rv->diff[i], 0, nextprime(diffLc[i] * totfactor), msize, -0.78f, 1);
+		allpassm_make(&rv->diff[i], 1, nextprime(diffRc[i] * totfactor), msize, -0.78f, 1);
 	}
 
 	static const int crossLc[4] = { 430, 341, 264, 174 };
 	static const int crossRc[4] = { 447, 324, 247, 191 };
 	for (int i = 0; i < 4; i++){
-		allpass_make(&rv->crossL[i], nextprime(crossLc[i] * totfactor), 0.78f, 1);
-		allpass_make(&rv->crossR[i], nextprime(crossRc[i] * totfactor), 0.78f, 1);
+		allpass_make(&rv->cross[i], 0, nextprime(crossLc[i] * totfactor), 0.78f, 1);
+		allpass_make(&rv->cross[i], 1, nextprime(crossRc[i] * totfactor), 0.78f, 1);
 	}
 
-	iir1_makeLPF(&rv->clpfL, osrate, inputlpf);
-	rv->clpfR = rv->clpfL;
+	sf_rv_iir1_st iir1;
+	iir1_makeLPF(&iir1, osrate, inputlpf);
+	iir1_make_lr(&rv->clpf, &iir1);
 
-	delay_make(&rv->cdelayL , nextprime(1572 * totfactor));
-	delay_make(&rv->cdelayR , nextprime(  16 * totfactor));
-	delay_make(&rv->dampdL  , nextprime(   2 * totfactor));
-	delay_make(&rv->dampdR  , nextprime(       totfactor));
-	delay_make(&rv->cbassd1L, nextprime(1055 * totfactor));
-	delay_make(&rv->cbassd1R, nextprime(1460 * totfactor));
-	delay_make(&rv->cbassd2L, nextprime( 344 * totfactor));
-	delay_make(&rv->cbassd2R, nextprime( 500 * totfactor));
+	delay_make(&rv->cdelay , 0, nextprime(1572 * totfactor));
+	delay_make(&rv->cdelay , 1, nextprime(  16 * totfactor));
+	delay_make(&rv->dampd  , 0, nextprime(   2 * totfactor));
+	delay_make(&rv->dampd  , 1, nextprime(       totfactor));
+	delay_make(&rv->cbassd1, 0, nextprime(1055 * totfactor));
+	delay_make(&rv->cbassd1, 1, nextprime(1460 * totfactor));
+	delay_make(&rv->cbassd2, 0, nextprime( 344 * totfactor));
+	delay_make(&rv->cbassd2, 1, nextprime( 500 * totfactor));
 
-	biquad_makeAPF(&rv->bassapL, osrate, 150.0f, 4.0f);
-	rv->bassapR = rv->bassapL;
+	sf_rv_biquad_st bq;
+	biquad_makeAPF(&bq, osrate, 150.0f, 4.0f);
+	biquad_make_lr(&rv->bassap, &bq);
 
-	biquad_makeLPF(&rv->basslpL, osrate, basslpf, 2.0f);
-	rv->basslpR = rv->basslpL;
+	biquad_makeLPF(&bq, osrate, basslpf, 2.0f);
+	biquad_make_lr(&rv->basslp, &bq);
 
-	iir1_makeLPF(&rv->damplpL, osrate, damplpf);
-	rv->damplpR = rv->damplpL;
+	iir1_makeLPF(&iir1, osrate, damplpf);
+	iir1_make_lr(&rv->damplp, &iir1);
 
 	float decay0 = powf(10.0f, log10f(0.237f) / rt60);
 	float decay1 = powf(10.0f, log10f(0.938f) / rt60);
@@ -741,23 +931,23 @@ void sf_advancereverb(sf_reverb_state_st *rv, int rate,
 	float decay3 = powf(10.0f, log10f(0.906f) / rt60);
 	rv->loopdecay = decay0;
 	msize = nextprime(32 * totfactor);
-	allpassm_make(&rv->dampap1L, nextprime(239 * totfactor), msize, 0.375f, decay2);
-	allpassm_make(&rv->dampap1R, nextprime(205 * totfactor), msize, 0.375f, decay2);
-	allpassm_make(&rv->dampap2L, nextprime(392 * totfactor), msize, 0.312f, decay3);
-	allpassm_make(&rv->dampap2R, nextprime(329 * totfactor), msize, 0.312f, decay3);
+	allpassm_make(&rv->dampap1, 0, nextprime(239 * totfactor), msize, 0.375f, decay2);
+	allpassm_make(&rv->dampap1, 1, nextprime(205 * totfactor), msize, 0.375f, decay2);
+	allpassm_make(&rv->dampap2, 0, nextprime(392 * totfactor), msize, 0.312f, decay3);
+	allpassm_make(&rv->dampap2, 1, nextprime(329 * totfactor), msize, 0.312f, decay3);
 
-	allpass2_make(&rv->cbassap1L, nextprime(1944 * totfactor), nextprime(612 * totfactor),
+	allpass2_make(&rv->cbassap1, 0, nextprime(1944 * totfactor), nextprime(612 * totfactor),
 		0.250f, 0.406f, decay1, decay2);
-	allpass2_make(&rv->cbassap1R, nextprime(2032 * totfactor), nextprime(368 * totfactor),
+	allpass2_make(&rv->cbassap1, 1, nextprime(2032 * totfactor), nextprime(368 * totfactor),
 		0.250f, 0.406f, decay1, decay2);
 
-	allpass3_make(&rv->cbassap2L,
+	allpass3_make(&rv->cbassap2, 0,
 		nextprime(1212 * totfactor),
 		nextprime( 121 * totfactor),
 		nextprime( 816 * totfactor),
 		nextprime(1264 * totfactor),
 		0.250f, 0.250f, 0.406f, decay1, decay1, decay2);
-	allpass3_make(&rv->cbassap2R,
+	allpass3_make(&rv->cbassap2, 1,
 		nextprime(1452 * totfactor),
 		nextprime(   5 * totfactor),
 		nextprime( 688 * totfactor),
@@ -771,25 +961,85 @@ void sf_advancereverb(sf_reverb_state_st *rv, int rate,
 	for (int i = 0; i < 32; i++)
 		rv->outco[i] = outco[i] * totfactor;
 
-	comb_make(&rv->combL, nextprime(22 * osrate / 1000));
-	rv->combR = rv->combL;
+	comb_make(&rv->comb, 0, nextprime(22 * osrate / 1000));
+	comb_make(&rv->comb, 1, nextprime(22 * osrate / 1000));
 
-	biquad_makeLPF(&rv->lastlpfL, osrate, outputlpf, 1.0f);
-	rv->lastlpfR = rv->lastlpfL;
+	biquad_makeLPF(&bq, osrate, outputlpf, 1.0f);
+	biquad_make_lr(&rv->lastlpf, &bq);
 
 	int delaysamp = osrate * delay;
-	if (delaysamp >= 0){
-		delay_make(&rv->inpdelayL, 0);
-		delay_make(&rv->inpdelayR, 0);
-		delay_make(&rv->lastdelayL, delaysamp);
-		delay_make(&rv->lastdelayR, delaysamp);
+	for (int c = 0; c < 2; c++){
+		if (delaysamp >= 0){
+			delay_make(&rv->inpdelay, c, 0);
+			delay_make(&rv->lastdelay, c, delaysamp);
+		}
+		else{
+			delay_make(&rv->inpdelay, c, -delaysamp);
+			delay_make(&rv->lastdelay, c, 0);
+		}
 	}
-	else{
-		delay_make(&rv->inpdelayL, -delaysamp);
-		delay_make(&rv->inpdelayR, -delaysamp);
-		delay_make(&rv->lastdelayL, 0);
-		delay_make(&rv->lastdelayR, 0);
+}
+
+// binds the buffers into the arena, false when it is too small
+static bool reverb_fit(sf_reverb_state_st *rv){
+	sf_rv_arena_st arena = { NULL, 0 };
+	reverb_bind(rv, &arena);
+	if (rv->arena == NULL || arena.used > rv->arena_size)
+		return false;
+	arena.base = rv->arena;
+	arena.used = 0;
+	reverb_bind(rv, &arena);
+	return true;
+}
+
+bool sf_advancereverb(sf_reverb_state_st *rv, int rate,
+	int oversamplefactor, float ertolate, float erefwet, float dry, float ereffactor,
+	float erefwidth, float width, float wet, float wander, float bassb, float spin, float inputlpf,
+	float basslpf, float damplpf, float outputlpf, float rt60, float delay){
+
+	rv->params = (sf_rv_params_st){ rate, oversamplefactor, ertolate, erefwet, dry, ereffactor,
+		erefwidth, width, wet, wander, bassb, spin, inputlpf, basslpf, damplpf, outputlpf, rt60,
+		delay };
+
+	// measure the high tier, every other one fits in its layout, and allocate only when it grew
+	reverb_make(rv, SF_REVERB_QUALITY_HIGH);
+	sf_rv_arena_st arena = { NULL, 0 };
+	reverb_bind(rv, &arena);
+	if (arena.used > rv->arena_size){
+		sf_reverb_free(rv);
+		rv->arena_mem = malloc(sizeof(float) * (arena.used + SF_REVERB_ALIGN));
+		if (rv->arena_mem == NULL)
+			return false; // the measuring pass left every buffer NULL
+		rv->arena = (float *)(((uintptr_t)rv->arena_mem + 63) & ~(uintptr_t)63);
+		rv->arena_size = arena.used;
 	}
+
+	if (rv->quality != SF_REVERB_QUALITY_HIGH)
+		reverb_make(rv, rv->quality);
+	return reverb_fit(rv);
+}
+
+bool sf_reverb_set_quality(sf_reverb_state_st *rv, sf_reverb_quality quality){
+	if (quality < SF_REVERB_QUALITY_HIGH || quality > SF_REVERB_QUALITY_DRAFT)
+		return false;
+	rv->quality = quality;
+	if (rv->arena == NULL)
+		return false; // no preset yet, it will be built at this tier
+	reverb_make(rv, quality);
+	if (reverb_fit(rv))
+		return true;
+	// cannot happen with the tiers above, but the arena always holds the high tier
+	rv->quality = SF_REVERB_QUALITY_HIGH;
+	reverb_make(rv, SF_REVERB_QUALITY_HIGH);
+	reverb_fit(rv);
+	return false;
+}
+
+void sf_reverb_free(sf_reverb_state_st *rv){
+	free(rv->arena_mem);
+	rv->arena_mem = NULL;
+	rv->arena = NULL;
+	rv->arena_size = 0;
 }
 
 void sf_reverb_process(sf_reverb_state_st *rv, int size, sf_sample_st *input, sf_sample_st *output){
@@ -798,143 +1048,130 @@ void sf_reverb_process(sf_reverb_state_st *rv, int size, sf_sample_st *input, sf
 	const float modnoise2 = 0.06f;
 	const float crossfeed = 0.4f;
 
+	// parameters broadcast to both lanes
+	const gs_f4 crossfeedv = gs_f4_set1(crossfeed);
+	const gs_f4 loopdecay = gs_f4_set1(rv->loopdecay);
+	const gs_f4 bassb = gs_f4_set1(rv->bassb);
+	const gs_f4 wet1 = gs_f4_set1(rv->wet1);
+	const gs_f4 wet2 = gs_f4_set1(rv->wet2);
+	const gs_f4 dry = gs_f4_set1(rv->dry);
+	const gs_f4 ertolate = gs_f4_set1(rv->ertolate);
+	const gs_f4 erefwet = gs_f4_set1(rv->erefwet);
+	const int *oc = rv->outco;
+
 	// oversample buffer
-	float osL[SF_REVERB_OF], osR[SF_REVERB_OF];
+	gs_f4 os[SF_REVERB_OF];
+
+	if (rv->arena == NULL){ // allocation failed
+		memmove(output, input, sizeof(sf_sample_st) * size);
+		return;
+	}
 
 	for (int i = 0; i < size; i++){
+		gs_f4 in = lr_make(input[i].L, input[i].R);
+
 		// early reflection
-		sf_sample_st er = earlyref_step(&rv->earlyref, input[i]);
-		float erL = er.L * rv->ertolate + input[i].L;
-		float erR = er.R * rv->ertolate + input[i].R;
+		gs_f4 er = earlyref_step(&rv->earlyref, in);
 
 		// oversample the single input into multiple outputs
-		oversample_stepup(&rv->oversampleL, erL, osL);
-		oversample_stepup(&rv->oversampleR, erR, osR);
+		oversample_stepup(&rv->oversample, gs_f4_add(gs_f4_mul(er, ertolate), in), os);
 
 		// for each oversampled sample...
-		for (int i2 = 0; i2 < rv->oversampleL.factor; i2++){
+		for (int i2 = 0; i2 < rv->oversample.factor; i2++){
 			// dc cut
-			float outL = dccut_step(&rv->dccutL, osL[i2]);
-			float outR = dccut_step(&rv->dccutR, osR[i2]);
+			gs_f4 out = dccut_step(&rv->dccut, os[i2]);
 
 			// noise
-			float mnoise = noise_step(&rv->noise);
-			float lfo = (lfo_step(&rv->lfo1) + modnoise1 * mnoise) * rv->wander;
-			lfo = iir1_step(&rv->lfo1_lpf, lfo);
-			mnoise *= modnoise2;
-
-			// diffusion
-			for (int i = 0, s = -1; i < 10; i++, s = -s){
-				outL = allpassm_step(&rv->diffL[i], outL, lfo * s, mnoise);
-				outR = allpassm_step(&rv->diffR[i], outR, lfo, mnoise * s);
+			float mnoise = 0, lfo = 0;
+			if (rv->modulation){
+				mnoise = noise_step(&rv->noise);
+				lfo = (lfo_step(&rv->lfo1) + modnoise1 * mnoise) * rv->wander;
+				lfo = iir1_step(&rv->lfo1_lpf, lfo);
+				mnoise *= modnoise2;
 			}
 
-			// cross fade
-			float crossL = outL, crossR = outR;
-			for (int i = 0; i < 4; i++){
-				crossL = allpass_step(&rv->crossL[i], crossL);
-				crossR = allpass_step(&rv->crossR[i], crossR);
+			// diffusion, L flips the sign of the modulation and R of the feedback noise per stage
+			const gs_f4 mod1 = lr_make(-lfo, lfo), mod2 = lr_make(lfo, lfo);
+			const gs_f4 fbmod1 = lr_make(mnoise, -mnoise), fbmod2 = lr_make(mnoise, mnoise);
+			for (int i = 0; i < rv->diffstages; i += 2){
+				out = allpassm_step(&rv->diff[i], out, mod1, fbmod1);
+				out = allpassm_step(&rv->diff[i + 1], out, mod2, fbmod2);
 			}
-			outL = iir1_step(&rv->clpfL, outL + crossfeed * crossR);
-			outR = iir1_step(&rv->clpfR, outR + crossfeed * crossL);
+
+			// cross fade, each channel gets the other's cross signal
+			gs_f4 cross = out;
+			for (int i = 0; i < 4; i++)
+				cross = allpass_step(&rv->cross[i], cross);
+			out = iir1_step_lr(&rv->clpf,
+				gs_f4_add(out, gs_f4_mul(crossfeedv, gs_f4_swap_pairs(cross))));
 
 			// bass boost
-			crossL = delay_getlast(&rv->cdelayL);
-			crossR = delay_getlast(&rv->cdelayR);
-			outL += rv->loopdecay *
-				(crossR + rv->bassb * biquad_step(&rv->basslpL, biquad_step(&rv->bassapL, crossR)));
-			outR += rv->loopdecay *
-				(crossL + rv->bassb * biquad_step(&rv->basslpR, biquad_step(&rv->bassapR, crossL)));
+			cross = gs_f4_swap_pairs(delay_getlast(&rv->cdelay));
+			out = gs_f4_add(out, gs_f4_mul(loopdecay, gs_f4_add(cross, gs_f4_mul(bassb,
+				biquad_step_lr(&rv->basslp, biquad_step_lr(&rv->bassap, cross))))));
 
 			// dampening
-			outL = allpassm_step(&rv->dampap2L,
-				delay_step(&rv->dampdL,
-				allpassm_step(&rv->dampap1L,
-				iir1_step(&rv->damplpL, outL), lfo, mnoise)),
-				-lfo, -mnoise);
-			outR = allpassm_step(&rv->dampap2R,
-				delay_step(&rv->dampdR,
-				allpassm_step(&rv->dampap1R,
-				iir1_step(&rv->damplpR, outR), -lfo, -mnoise)),
-				lfo, mnoise);
+			const gs_f4 lfo_lr = lr_make(lfo, -lfo), mnoise_lr = lr_make(mnoise, -mnoise);
+			const gs_f4 lfo_rl = gs_f4_swap_pairs(lfo_lr), mnoise_rl = gs_f4_swap_pairs(mnoise_lr);
+			out = allpassm_step(&rv->dampap2,
+				delay_step(&rv->dampd,
+				allpassm_step(&rv->dampap1,
+				iir1_step_lr(&rv->damplp, out), lfo_lr, mnoise_lr)),
+				lfo_rl, mnoise_rl);
 
 			// update cross fade bass boost delay
-			delay_step(&rv->cdelayL,
-				allpass3_step(&rv->cbassap2L,
-				delay_step(&rv->cbassd2L,
-				allpass2_step(&rv->cbassap1L,
-				delay_step(&rv->cbassd1L, outL))),
-					lfo));
-			delay_step(&rv->cdelayR,
-				allpass3_step(&rv->cbassap2R,
-				delay_step(&rv->cbassd2R,
-				allpass2_step(&rv->cbassap1R,
-				delay_step(&rv->cbassd1R, outR))),
-					-lfo));
-
-			//
-			float D1 =
-				delay_get    (&rv->cbassd1L , rv->outco[ 0]);
-			float D2 =
-				delay_get    (&rv->cbassd2L , rv->outco[ 1]) -
-				delay_get    (&rv->cbassd2R , rv->outco[ 2]) +
-				delay_get    (&rv->cbassd2L , rv->outco[ 3]) -
-				delay_get    (&rv->cdelayR  , rv->outco[ 4]) -
-				delay_get    (&rv->cbassd1R , rv->outco[ 5]) -
-				delay_get    (&rv->cbassd2R , rv->outco[ 6]);
-			float D3 =
-				delay_get    (&rv->cdelayL  , rv->outco[ 7]) +
-				allpass2_get1(&rv->cbassap1L, rv->outco[ 8]) +
-				allpass2_get2(&rv->cbassap1L, rv->outco[ 9]) -
-				allpass2_get2(&rv->cbassap1R, rv->outco[10]) +
-				allpass3_get1(&rv->cbassap2L, rv->outco[11]) +
-				allpass3_get2(&rv->cbassap2L, rv->outco[12]) +
-				allpass3_get3(&rv->cbassap2L, rv->outco[13]) -
-				allpass3_get2(&rv->cbassap2R, rv->outco[14]);
-			float D4 =
-				delay_get    (&rv->cdelayL  , rv->outco[15]);
-
-			float B1 =
-				delay_get    (&rv->cbassd1R , rv->outco[16]);
-			float B2 =
-				delay_get    (&rv->cbassd2R , rv->outco[17]) -
-				delay_get    (&rv->cbassd2L , rv->outco[18]) +
-				delay_get    (&rv->cbassd2R , rv->outco[19]) -
-				delay_get    (&rv->cdelayL  , rv->outco[20]) -
-				delay_get    (&rv->cbassd1L , rv->outco[21]) -
-				delay_get    (&rv->cbassd2L , rv->outco[22]);
-			float B3 =
-				delay_get    (&rv->cdelayR  , rv->outco[23]) +
-				allpass2_get1(&rv->cbassap1R, rv->outco[24]) +
-				allpass2_get2(&rv->cbassap1R, rv->outco[25]) -
-				allpass2_get2(&rv->cbassap1L, rv->outco[26]) +
-				allpass3_get1(&rv->cbassap2R, rv->outco[27]) +
-				allpass3_get2(&rv->cbassap2R, rv->outco[28]) +
-				allpass3_get3(&rv->cbassap2R, rv->outco[29]) -
-				allpass3_get2(&rv->cbassap2L, rv->outco[30]);
-			float B4 =
-				delay_get    (&rv->cdelayR  , rv->outco[31]);
-
-			float D = D1 * 0.469f + D2 * 0.219f + D3 * 0.064f + D4 * 0.045f;
-			float B = B1 * 0.469f + B2 * 0.219f + B3 * 0.064f + B4 * 0.045f;
-
-			lfo = iir1_step(&rv->lfo2_lpf, lfo_step(&rv->lfo2) * rv->wander);
-			outL = comb_step(&rv->combL, D, lfo);
-			outR = comb_step(&rv->combR, B, -lfo);
-
-			outL = delay_step(&rv->lastdelayL, biquad_step(&rv->lastlpfL, outL));
-			outR = delay_step(&rv->lastdelayR, biquad_step(&rv->lastlpfR, outR));
-
-			osL[i2] = outL * rv->wet1 + outR * rv->wet2 +
-				delay_step(&rv->inpdelayL, osL[i2]) * rv->dry;
-			osR[i2] = outR * rv->wet1 + outL * rv->wet2 +
-				delay_step(&rv->inpdelayR, osR[i2]) * rv->dry;
+			delay_step(&rv->cdelay,
+				allpass3_step(&rv->cbassap2,
+				delay_step(&rv->cbassd2,
+				allpass2_step(&rv->cbassap1,
+				delay_step(&rv->cbassd1, out))),
+					lfo_lr));
+
+			// output taps, lane 0 builds D (left) and lane 1 builds B (right) from mirrored taps;
+			// the swapped gets read the opposite channel
+			#define SWAP gs_f4_swap_pairs
+			gs_f4 D1 =
+				delay_get_lr(&rv->cbassd1, oc[ 0], oc[16]);
+			gs_f4 D2 = gs_f4_sub(gs_f4_sub(gs_f4_sub(gs_f4_add(gs_f4_sub(
+				delay_get_lr(&rv->cbassd2, oc[ 1], oc[17]),
+				SWAP(delay_get_lr(&rv->cbassd2, oc[18], oc[ 2]))),
+				delay_get_lr(&rv->cbassd2, oc[ 3], oc[19])),
+				SWAP(delay_get_lr(&rv->cdelay , oc[20], oc[ 4]))),
+				SWAP(delay_get_lr(&rv->cbassd1, oc[21], oc[ 5]))),
+				SWAP(delay_get_lr(&rv->cbassd2, oc[22], oc[ 6])));
+			gs_f4 D3 = gs_f4_sub(gs_f4_add(gs_f4_add(gs_f4_add(gs_f4_sub(gs_f4_add(gs_f4_add(
+				delay_get_lr(&rv->cdelay, oc[ 7], oc[23]),
+				lr_make(allpass2_get1(&rv->cbassap1, 0, oc[ 8]), allpass2_get1(&rv->cbassap1, 1, oc[24]))),
+				lr_make(allpass2_get2(&rv->cbassap1, 0, oc[ 9]), allpass2_get2(&rv->cbassap1, 1, oc[25]))),
+				lr_make(allpass2_get2(&rv->cbassap1, 1, oc[10]), allpass2_get2(&rv->cbassap1, 0, oc[26]))),
+				lr_make(allpass3_get1(&rv->cbassap2, 0, oc[11]), allpass3_get1(&rv->cbassap2, 1, oc[27]))),
+				lr_make(allpass3_get2(&rv->cbassap2, 0, oc[12]), allpass3_get2(&rv->cbassap2, 1, oc[28]))),
+				lr_make(allpass3_get3(&rv->cbassap2, 0, oc[13]), allpass3_get3(&rv->cbassap2, 1, oc[29]))),
+				lr_make(allpass3_get2(&rv->cbassap2, 1, oc[14]), allpass3_get2(&rv->cbassap2, 0, oc[30])));
+			gs_f4 D4 =
+				delay_get_lr(&rv->cdelay, oc[15], oc[31]);
+			#undef SWAP
+
+			gs_f4 D = gs_f4_add(gs_f4_add(gs_f4_add(
+				gs_f4_mul(D1, gs_f4_set1(0.469f)),
+				gs_f4_mul(D2, gs_f4_set1(0.219f))),
+				gs_f4_mul(D3, gs_f4_set1(0.064f))),
+				gs_f4_mul(D4, gs_f4_set1(0.045f)));
+
+			if (rv->modulation)
+				lfo = iir1_step(&rv->lfo2_lpf, lfo_step(&rv->lfo2) * rv->wander);
+			out = comb_step(&rv->comb, D, lr_make(lfo, -lfo));
+
+			out = delay_step(&rv->lastdelay, biquad_step_lr(&rv->lastlpf, out));
+
+			os[i2] = gs_f4_add(gs_f4_add(gs_f4_mul(out, wet1), gs_f4_mul(gs_f4_swap_pairs(out), wet2)),
+				gs_f4_mul(delay_step(&rv->inpdelay, os[i2]), dry));
 		}
 
-		float outL = oversample_stepdown(&rv->oversampleL, osL);
-		float outR = oversample_stepdown(&rv->oversampleR, osR);
-		outL += er.L * rv->erefwet + input[i].L * rv->dry;
-		outR += er.R * rv->erefwet + input[i].R * rv->dry;
-		output[i] = (sf_sample_st){ outL, outR };
+		gs_f4 out = oversample_stepdown(&rv->oversample, os);
+		out = gs_f4_add(out, gs_f4_add(gs_f4_mul(er, erefwet), gs_f4_mul(in, dry)));
+		float o[SF_REVERB_LANES];
+		gs_f4_store(o, out);
+		output[i] = (sf_sample_st){ o[0], o[1] };
 	}
 }
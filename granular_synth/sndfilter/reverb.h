@@ -9,18 +9,22 @@
 #define SNDFILTER_REVERB__H
 
 #include "snd.h"
+#include <stddef.h>
+#include <stdint.h>
 
 // this API works by first initializing an sf_reverb_state_st structure, then using it to process a
 // sample in chunks
 //
 // for example, say you're processing a stream in 128 samples per chunk:
 //
-//   sf_reverb_state_st rv;
+//   sf_reverb_state_st rv = {0};
 //   sf_presetreverb(&rv, 44100, SF_REVERB_PRESET_DEFAULT);
 //
 //   for each 128 length sample:
 //     sf_reverb_process(&rv, 128, input, output);
 //
+//   sf_reverb_free(&rv);
+//
 // notice that sf_reverb_process will change a lot of the member variables inside of the state
 // structure, since these values must be carried over across chunk boundaries
 //
@@ -54,14 +58,26 @@
 //
 // each component is designed to work one step at a time, so any size sample can be streamed through
 // in one pass
+//
+// the delay lines are not stored in the state structure. they are sized from the sample rate and the
+// preset, then carved out of one arena in the order the signal goes through them, so that memory
+// grows with what the preset needs instead of the worst case. the state must start zeroed, presets
+// can be applied again (the arena is reused when it's large enough) and sf_reverb_free releases it
+
+// stereo pairs
+// every component exists once for the left and once for the right channel; both instances live in
+// one structure and step together, lane 0 of a 4-wide vector being L and lane 1 being R (the other
+// two lanes are padding). per-lane coefficients and state are stored as float[SF_REVERB_LANES] so
+// they load straight into a register, while the delay lines keep one buffer per channel
+#define SF_REVERB_LANES     4
 
 // delay
-// delay buffer size; maximum size allowed for a delay
+// maximum size allowed for a delay
 #define SF_REVERB_DS        9814
 typedef struct {
-	int pos;                 // current write position
-	int size;                // delay size
-	float buf[SF_REVERB_DS]; // delay buffer
+	int pos[2];     // current write position
+	int size[2];    // delay size
+	float *buf[2];  // delay buffer (in the arena)
 } sf_rv_delay_st;
 
 // 1st order IIR filter
@@ -72,30 +88,46 @@ typedef struct {
 	float y1; // state
 } sf_rv_iir1_st;
 
+typedef struct {
+	float a2[SF_REVERB_LANES]; // coefficients
+	float b1[SF_REVERB_LANES];
+	float b2[SF_REVERB_LANES];
+	float y1[SF_REVERB_LANES]; // state
+} sf_rv_iir1_lr_st;
+
 // biquad
-// note: we don't use biquad.c because we want to step through the sound one sample at a time, one
-//       channel at a time
+// note: we don't use biquad.c because we want to step through the sound one sample at a time
+// the scalar version only holds the coefficients computed by the *_make functions
 typedef struct {
 	float b0; // biquad coefficients
 	float b1;
 	float b2;
 	float a1;
 	float a2;
-	float xn1; // input[n - 1]
-	float xn2; // input[n - 2]
-	float yn1; // output[n - 1]
-	float yn2; // output[n - 2]
 } sf_rv_biquad_st;
 
+typedef struct {
+	float b0[SF_REVERB_LANES]; // biquad coefficients
+	float b1[SF_REVERB_LANES];
+	float b2[SF_REVERB_LANES];
+	float a1[SF_REVERB_LANES];
+	float a2[SF_REVERB_LANES];
+	float xn1[SF_REVERB_LANES]; // input[n - 1]
+	float xn2[SF_REVERB_LANES]; // input[n - 2]
+	float yn1[SF_REVERB_LANES]; // output[n - 1]
+	float yn2[SF_REVERB_LANES]; // output[n - 2]
+} sf_rv_biquad_lr_st;
+
 // early reflection
+// delayX feeds each channel with the other one (R into L, L into R)
 typedef struct {
-	int             delaytblL[18], delaytblR[18];
-	sf_rv_delay_st  delayPWL     , delayPWR     ;
-	sf_rv_delay_st  delayRL      , delayLR      ;
-	sf_rv_biquad_st allpassXL    , allpassXR    ;
-	sf_rv_biquad_st allpassL     , allpassR     ;
-	sf_rv_iir1_st   lpfL         , lpfR         ;
-	sf_rv_iir1_st   hpfL         , hpfR         ;
+	int                delaytblL[18], delaytblR[18];
+	sf_rv_delay_st     delayPW;
+	sf_rv_delay_st     delayX;
+	sf_rv_biquad_lr_st allpassX;
+	sf_rv_biquad_lr_st allpass;
+	sf_rv_iir1_lr_st   lpf;
+	sf_rv_iir1_lr_st   hpf;
 	float wet1, wet2;
 } sf_rv_earlyref_st;
 
@@ -103,16 +135,16 @@ typedef struct {
 // maximum oversampling factor
 #define SF_REVERB_OF        4
 typedef struct {
-	int factor;           // oversampling factor [1 to SF_REVERB_OF]
-	sf_rv_biquad_st lpfU; // lowpass filter used for upsampling
-	sf_rv_biquad_st lpfD; // lowpass filter used for downsampling
+	int factor;              // oversampling factor [1 to SF_REVERB_OF]
+	sf_rv_biquad_lr_st lpfU; // lowpass filter used for upsampling
+	sf_rv_biquad_lr_st lpfD; // lowpass filter used for downsampling
 } sf_rv_oversample_st;
 
 // dc cut
 typedef struct {
-	float gain;
-	float y1;
-	float y2;
+	float gain[SF_REVERB_LANES];
+	float y1[SF_REVERB_LANES];
+	float y2[SF_REVERB_LANES];
 } sf_rv_dccut_st;
 
 // fractal noise cache
@@ -120,7 +152,8 @@ typedef struct {
 #define SF_REVERB_NS        (1<<15)
 typedef struct {
 	int pos;                 // current read position in the buffer
-	float buf[SF_REVERB_NS]; // buffer filled with noise
+	uint32_t seed, counter;  // random state, per instance so reverbs don't disturb each other
+	float *buf;              // buffer filled with noise (in the arena)
 } sf_rv_noise_st;
 
 // low-frequency oscilator (LFO)
@@ -136,11 +169,11 @@ typedef struct {
 // maximum size
 #define SF_REVERB_APS       6299
 typedef struct {
-	int pos;
-	int size;
-	float feedback;
-	float decay;
-	float buf[SF_REVERB_APS];
+	int pos[2];
+	int size[2];
+	float feedback[SF_REVERB_LANES];
+	float decay[SF_REVERB_LANES];
+	float *buf[2];
 } sf_rv_allpass_st;
 
 // 2nd order all-pass filter
@@ -148,12 +181,12 @@ typedef struct {
 #define SF_REVERB_AP2S1     11437
 #define SF_REVERB_AP2S2     3449
 typedef struct {
-	//    line 1                 line 2
-	int   pos1                 , pos2                 ;
-	int   size1                , size2                ;
-	float feedback1            , feedback2            ;
-	float decay1               , decay2               ;
-	float buf1[SF_REVERB_AP2S1], buf2[SF_REVERB_AP2S2];
+	//    line 1                          line 2
+	int   pos1[2]                       , pos2[2]                       ;
+	int   size1[2]                      , size2[2]                      ;
+	float feedback1[SF_REVERB_LANES]    , feedback2[SF_REVERB_LANES]    ;
+	float decay1[SF_REVERB_LANES]       , decay2[SF_REVERB_LANES]       ;
+	float *buf1[2]                      , *buf2[2]                      ;
 } sf_rv_allpass2_st;
 
 // 3rd order all-pass filter with modulation
@@ -163,12 +196,13 @@ typedef struct {
 #define SF_REVERB_AP3S2     4597
 #define SF_REVERB_AP3S3     7541
 typedef struct {
-	//    line 1 (with modulation)                 line 2                 line 3
-	int   rpos1, wpos1                           , pos2                 , pos3                 ;
-	int   size1, msize1                          , size2                , size3                ;
-	float feedback1                              , feedback2            , feedback3            ;
-	float decay1                                 , decay2               , decay3               ;
-	float buf1[SF_REVERB_AP3S1 + SF_REVERB_AP3M1], buf2[SF_REVERB_AP3S2], buf3[SF_REVERB_AP3S3];
+	//    line 1 (with modulation)                    line 2                      line 3
+	int   rpos1[2], wpos1[2]                        , pos2[2]                   , pos3[2]                   ;
+	int   size1[2]                                  , size2[2]                  , size3[2]                  ;
+	float msize1[SF_REVERB_LANES]                   ;
+	float feedback1[SF_REVERB_LANES]                , feedback2[SF_REVERB_LANES], feedback3[SF_REVERB_LANES];
+	float decay1[SF_REVERB_LANES]                   , decay2[SF_REVERB_LANES]   , decay3[SF_REVERB_LANES]   ;
+	float *buf1[2]                                  , *buf2[2]                  , *buf3[2]                  ;
 } sf_rv_allpass3_st;
 
 // modulated all-pass filter
@@ -176,54 +210,72 @@ typedef struct {
 #define SF_REVERB_APMS      8681
 #define SF_REVERB_APMM      137
 typedef struct {
-	int rpos, wpos;
-	int size, msize;
-	float feedback;
-	float decay;
-	float z1;
-	float buf[SF_REVERB_APMS + SF_REVERB_APMM];
+	int rpos[2], wpos[2];
+	int size[2];
+	float msize[SF_REVERB_LANES];
+	float feedback[SF_REVERB_LANES];
+	float decay[SF_REVERB_LANES];
+	float z1[SF_REVERB_LANES];
+	float *buf[2];
 } sf_rv_allpassm_st;
 
 // comb filter
 // maximum size of the buffer
 #define SF_REVERB_CS        4229
 typedef struct {
-	int pos;
-	int size;
-	float buf[SF_REVERB_CS];
+	int pos[2];
+	int size[2];
+	float *buf[2];
 } sf_rv_comb_st;
 
+// quality tiers, trading network depth for CPU
+// the arena is laid out for HIGH, the largest, so switching tiers never allocates
+// HIGH is zero so a zeroed state runs the full network as designed
+typedef enum {
+	SF_REVERB_QUALITY_HIGH,   // the preset's oversampling, 10 diffusion stages, modulated
+	SF_REVERB_QUALITY_NORMAL, // no oversampling, 8 diffusion stages, modulated
+	SF_REVERB_QUALITY_DRAFT   // no oversampling, 4 diffusion stages, no modulation
+} sf_reverb_quality;
+
+// everything sf_advancereverb was given, kept so the network can be rebuilt for another tier
+typedef struct {
+	int rate;
+	int oversamplefactor;
+	float ertolate, erefwet, dry, ereffactor, erefwidth, width, wet, wander, bassb, spin;
+	float inputlpf, basslpf, damplpf, outputlpf, rt60, delay;
+} sf_rv_params_st;
+
 //
 // the final reverb state structure
 //
-// note: this is about 2megs, so you might not want to throw these around willy-nilly
+// the buffers live in the arena, the structure itself is a few KB
 typedef struct {
 	sf_rv_earlyref_st   earlyref;
-	sf_rv_oversample_st oversampleL, oversampleR;
-	sf_rv_dccut_st      dccutL     , dccutR     ;
+	sf_rv_oversample_st oversample;
+	sf_rv_dccut_st      dccut;
 	sf_rv_noise_st      noise;
 	sf_rv_lfo_st        lfo1;
 	sf_rv_iir1_st       lfo1_lpf;
-	sf_rv_allpassm_st   diffL[10]  , diffR[10]  ;
-	sf_rv_allpass_st    crossL[4]  , crossR[4]  ;
-	sf_rv_iir1_st       clpfL      , clpfR      ; // cross LPF
-	sf_rv_delay_st      cdelayL    , cdelayR    ; // cross delay
-	sf_rv_biquad_st     bassapL    , bassapR    ; // bass all-pass
-	sf_rv_biquad_st     basslpL    , basslpR    ; // bass lowpass
-	sf_rv_iir1_st       damplpL    , damplpR    ; // dampening lowpass
-	sf_rv_allpassm_st   dampap1L   , dampap1R   ; // dampening all-pass (1)
-	sf_rv_delay_st      dampdL     , dampdR     ; // dampening delay
-	sf_rv_allpassm_st   dampap2L   , dampap2R   ; // dampening all-pass (2)
-	sf_rv_delay_st      cbassd1L   , cbassd1R   ; // cross-fade bass delay (1)
-	sf_rv_allpass2_st   cbassap1L  , cbassap1R  ; // cross-fade bass allpass (1)
-	sf_rv_delay_st      cbassd2L   , cbassd2R   ; // cross-fade bass delay (2)
-	sf_rv_allpass3_st   cbassap2L  , cbassap2R  ; // cross-fade bass allpass (2)
+	sf_rv_allpassm_st   diff[10];
+	sf_rv_allpass_st    cross[4];
+	sf_rv_iir1_lr_st    clpf;     // cross LPF
+	sf_rv_delay_st      cdelay;   // cross delay
+	sf_rv_biquad_lr_st  bassap;   // bass all-pass
+	sf_rv_biquad_lr_st  basslp;   // bass lowpass
+	sf_rv_iir1_lr_st    damplp;   // dampening lowpass
+	sf_rv_allpassm_st   dampap1;  // dampening all-pass (1)
+	sf_rv_delay_st      dampd;    // dampening delay
+	sf_rv_allpassm_st   dampap2;  // dampening all-pass (2)
+	sf_rv_delay_st      cbassd1;  // cross-fade bass delay (1)
+	sf_rv_allpass2_st   cbassap1; // cross-fade bass allpass (1)
+	sf_rv_delay_st      cbassd2;  // cross-fade bass delay (2)
+	sf_rv_allpass3_st   cbassap2; // cross-fade bass allpass (2)
 	sf_rv_lfo_st        lfo2;
 	sf_rv_iir1_st       lfo2_lpf;
-	sf_rv_comb_st       combL      , combR      ;
-	sf_rv_biquad_st     lastlpfL   , lastlpfR   ;
-	sf_rv_delay_st      lastdelayL , lastdelayR ;
-	sf_rv_delay_st      inpdelayL  , inpdelayR  ;
+	sf_rv_comb_st       comb;
+	sf_rv_biquad_lr_st  lastlpf;
+	sf_rv_delay_st      lastdelay;
+	sf_rv_delay_st      inpdelay;
 	int outco[32];
 	float loopdecay;
 	float wet1, wet2;
@@ -232,6 +284,13 @@ typedef struct {
 	float ertolate; // early reflection mix parameters
 	float erefwet;
 	float dry;
+	sf_rv_params_st params;
+	sf_reverb_quality quality;
+	int diffstages;  // diffusion stages that run (even, up to 10)
+	bool modulation; // LFO and noise modulation of the delay lines
+	float *arena;     // every buffer above, 64-byte aligned inside arena_mem
+	void *arena_mem;
+	size_t arena_size; // floats available from arena
 } sf_reverb_state_st;
 
 typedef enum {
@@ -257,10 +316,12 @@ typedef enum {
 } sf_reverb_preset;
 
 // populate a reverb state with a preset
-void sf_presetreverb(sf_reverb_state_st *state, int rate, sf_reverb_preset preset);
+// these allocate the delay lines and return false when that fails, the reverb then passes the
+// input through
+bool sf_presetreverb(sf_reverb_state_st *state, int rate, sf_reverb_preset preset);
 
 // populate a reverb state with advanced parameters
-void sf_advancereverb(sf_reverb_state_st *rv,
+bool sf_advancereverb(sf_reverb_state_st *rv,
 	int rate,             // input sample rate (samples per second)
 	int oversamplefactor, // how much to oversample [1 to 4]
 	float ertolate,       // early reflection amount [0 to 1]
@@ -286,4 +347,13 @@ void sf_advancereverb(sf_reverb_state_st *rv,
 void sf_reverb_process(sf_reverb_state_st *state, int size, sf_sample_st *input,
 	sf_sample_st *output);
 
+// release the delay lines, the state can be populated again afterwards
+void sf_reverb_free(sf_reverb_state_st *state);
+
+// switch the quality tier without allocating; every filter and delay length is recomputed and the arena is
+// cleared, so the current tail is lost (LONGREVERB1 at 48 kHz: 20-60 us, a 256 frame block takes about 95)
+// it must not run concurrently with sf_reverb_process on the same state; to switch while audio plays, build
+// the tier in a second state and crossfade to it (before any preset is applied it only records the tier)
+bool sf_reverb_set_quality(sf_reverb_state_st *state, sf_reverb_quality quality);
+
 #endif // SNDFILTER_REVERB__H
@@ -0,0 +1,134 @@
+#include "worker_pool.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define WORK_TAG(work) ((uint32_t)(work) >> 16)
+#define WORK_COUNT(work) (((uint32_t)(work) >> 8) & 0xFFu)
+#define WORK_NEXT(work) ((uint32_t)(work) & 0xFFu)
+
+static void _worker_pool_do_jobs(worker_pool_t* pool, int thread, uint32_t tag) {
+	for (;;) {
+		const int32_t work = gs_atomic_load(&pool->work);
+		if (WORK_TAG(work) != tag || WORK_NEXT(work) >= WORK_COUNT(work)) {
+			return;
+		}
+
+		if (gs_atomic_cas(&pool->work, work, (int32_t)((uint32_t)work + 1)) != work) {
+			continue;
+		}
+
+		pool->job(pool->job_data, thread, (int)WORK_NEXT(work));
+		gs_atomic_add(&pool->pending, -1);
+	}
+}
+
+static void _worker_wake(worker_t* worker) {
+	if (gs_atomic_cas(&worker->parked, 1, 0) == 1) {
+		gs_semaphore_post(&worker->wake);
+	}
+}
+
+static void _worker_main(void* data) {
+	worker_t* worker = (worker_t*)data;
+	worker_pool_t* pool = worker->pool;
+
+	uint32_t seen = WORK_TAG(gs_atomic_load(&pool->work));
+	for (;;) {
+		int spins = 0;
+		uint32_t tag;
+		while ((tag = WORK_TAG(gs_atomic_load(&pool->work))) == seen && !gs_atomic_load(&pool->quit)) {
+			if (spins < GS_WORKER_SPIN_COUNT) {
+				spins++;
+				gs_cpu_pause();
+				continue;
+			}
+
+			// park, unless a run was published after the last check
+			gs_atomic_store(&worker->parked, 1);
+			if (WORK_TAG(gs_atomic_load(&pool->work)) != seen || gs_atomic_load(&pool->quit)) {
+				if (gs_atomic_cas(&worker->parked, 1, 0) == 1) {
+					continue;
+				}
+				// the waker cleared the flag first, consume its post
+			}
+			gs_semaphore_wait(&worker->wake);
+			spins = 0;
+		}
+
+		if (gs_atomic_load(&pool->quit)) {
+			break;
+		}
+
+		seen = tag;
+		_worker_pool_do_jobs(pool, worker->index, tag);
+	}
+}
+
+int worker_pool_init(worker_pool_t* pool, int num_workers) {
+	memset(pool, 0, sizeof(worker_pool_t));
+
+	if (num_workers > GS_MAX_WORKERS) num_workers = GS_MAX_WORKERS;
+
+	for (int i = 0; i < num_workers; i++) {
+		worker_t* worker = &pool->workers[pool->num_workers];
+		worker->pool = pool;
+		worker->index = pool->num_workers + 1;
+
+		if (!gs_semaphore_init(&worker->wake)) {
+			break;
+		}
+		if (!gs_thread_create(&worker->thread, _worker_main, worker)) {
+			gs_semaphore_free(&worker->wake);
+			break;
+		}
+		// workers render audio, keep them ahead of the GUI
+		gs_thread_raise_priority(&worker->thread);
+		pool->num_workers++;
+	}
+
+	return pool->num_workers;
+}
+
+void worker_pool_free(worker_pool_t* pool) {
+	gs_atomic_store(&pool->quit, 1);
+	for (int i = 0; i < pool->num_workers; i++) {
+		_worker_wake(&pool->workers[i]);
+	}
+
+	for (int i = 0; i < pool->num_workers; i++) {
+		gs_thread_join(&pool->workers[i].thread);
+		gs_semaphore_free(&pool->workers[i].wake);
+	}
+	pool->num_workers = 0;
+}
+
+void worker_pool_run(worker_pool_t* pool, worker_job_cb job, void* data, int num_jobs) {
+	assert(num_jobs <= 0xFF);
+
+	if (pool->num_workers == 0 || num_jobs <= 1) {
+		for (int i = 0; i < num_jobs; i++) {
+			job(data, 0, i);
+		}
+		return;
+	}
+
+	pool->job = job;
+	pool->job_data = data;
+	gs_atomic_store(&pool->pending, num_jobs);
+
+	// publishing the new tag starts the run
+	const uint32_t tag = (WORK_TAG(gs_atomic_load(&pool->work)) + 1) & 0xFFFFu;
+	gs_atomic_store(&pool->work, (int32_t)((tag << 16) | ((uint32_t)num_jobs << 8)));
+
+	// the calling thread takes a job as well, so one fewer worker is needed
+	for (int i = 0; i < pool->num_workers && i < num_jobs - 1; i++) {
+		_worker_wake(&pool->workers[i]);
+	}
+
+	_worker_pool_do_jobs(pool, 0, tag);
+
+	while (gs_atomic_load(&pool->pending) > 0) {
+		gs_cpu_pause();
+	}
+}
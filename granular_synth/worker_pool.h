@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "platform.h"
+
+#define GS_MAX_WORKERS 8
+#define GS_WORKER_SPIN_COUNT 4096 // pause iterations before an idle worker parks
+
+// fork/join pool for the audio thread
+// worker_pool_run hands out jobs with an atomic counter and the caller works on them too,
+// then spins until the workers are done. idle workers spin for a while and then park on a semaphore,
+// waking them is a semaphore post so the audio thread never blocks or takes a lock
+
+// thread is 0 for the calling thread and 1..num_workers for the workers
+typedef void (*worker_job_cb)(void* data, int thread, int job);
+
+typedef struct worker_pool_t worker_pool_t;
+
+typedef struct worker_t {
+	worker_pool_t* pool;
+	int index;
+	gs_thread_t thread;
+	gs_semaphore_t wake;
+	gs_atomic32_t parked;
+} worker_t;
+
+typedef struct worker_pool_t {
+	worker_t workers[GS_MAX_WORKERS];
+	int num_workers;
+
+	worker_job_cb job;
+	void* job_data;
+
+	// run tag (16 bits) | job count (8 bits) | next job (8 bits), packed so a worker that is late
+	// for one run can never claim a job of the next one
+	gs_atomic32_t work;
+	gs_atomic32_t pending; // jobs not finished yet
+	gs_atomic32_t quit;
+} worker_pool_t;
+
+// returns the number of workers started, clamped to GS_MAX_WORKERS
+int worker_pool_init(worker_pool_t* pool, int num_workers);
+void worker_pool_free(worker_pool_t* pool);
+
+// runs job(data, thread, 0..num_jobs-1) and returns once every job finished, num_jobs <= 255
+void worker_pool_run(worker_pool_t* pool, worker_job_cb job, void* data, int num_jobs);
+
+#endif // !WORKER_POOL_H